@@ -0,0 +1,200 @@
+/*
+ * i2c_emulated.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "I2C.h"
+#include "I2CModel.h"
+#include "device/EEPROM24CX.h"
+
+/*
+ * Runs EEPROM24CX and the I2C transaction queue against models on an
+ * emulated bus and checks the results. Needs no hardware; exits with 1
+ * if any check fails.
+ */
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+	printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok)
+		failures++;
+}
+
+static void testPageSplit()
+{
+	I2CEmulatedBus bus;
+	EEPROM24CXModel model(EEPROM_256K, EEPROM_64_PAGE, EEPROM_16_ADDR);
+	model.setBusyPolls(1);
+	bus.attach(0x50, &model);
+
+	I2C handle;
+	handle.open(&bus, 0x50, true);
+	EEPROM24C256 eeprom(&handle);
+
+	// 100..299 spans four pages; a chunk crossing a page boundary would
+	// wrap around to the start of its page
+	uint8_t data[200], back[200];
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+	check(eeprom.write(100, sizeof(data), data) == sizeof(data),
+			"write across pages returns the full length");
+	check(memcmp(&model.getMemory()[100], data, sizeof(data)) == 0,
+			"write across pages lands at the right addresses");
+	check(model.getStats().pageWrites == 4,
+			"write across pages takes one write cycle per page");
+	check(eeprom.read(100, sizeof(back), back) == sizeof(back)
+			&& memcmp(back, data, sizeof(back)) == 0,
+			"read back matches");
+}
+
+static void testBoundaries()
+{
+	I2CEmulatedBus bus;
+	EEPROM24CXModel model(EEPROM_2K, EEPROM_8_PAGE, EEPROM_16_ADDR);
+	model.setBusyPolls(1);
+	bus.attach(0x50, &model);
+
+	I2C handle;
+	handle.open(&bus, 0x50, true);
+	EEPROM24C02 eeprom(&handle);
+
+	std::vector<uint8_t> &memory = model.getMemory();
+	for (size_t i = 0; i < memory.size(); i++)
+		memory[i] = i;
+	check(eeprom.erase() == EEPROM_2K, "erase covers the whole memory");
+	bool blank = true;
+	for (size_t i = 0; i < memory.size(); i++)
+		blank = blank && memory[i] == 0xFF;
+	check(blank, "erase clears the last page");
+
+	uint8_t data[8] =
+	{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint8_t back[8];
+	check(eeprom.write(EEPROM_2K - 8, 8, data) == 8
+			&& memcmp(&memory[EEPROM_2K - 8], data, 8) == 0,
+			"write ending at the end of memory is not truncated");
+	check(eeprom.read(EEPROM_2K - 8, 8, back) == 8
+			&& memcmp(back, data, 8) == 0,
+			"read ending at the end of memory is not truncated");
+	check(eeprom.write(EEPROM_2K - 4, 8, data) == 4
+			&& memcmp(&memory[EEPROM_2K - 8], "\x01\x02\x03\x04\x01\x02\x03\x04",
+					8) == 0, "write past the end of memory is truncated");
+	check(eeprom.read(EEPROM_2K - 4, 8, back) == 4,
+			"read past the end of memory is truncated");
+	errno = 0;
+	check(eeprom.read(EEPROM_2K, 1, back) < 0 && errno == EINVAL,
+			"read at the end of memory fails");
+}
+
+static void testQueue()
+{
+	I2CEmulatedBus bus(0, 10000);
+	I2CRegisterModel regs(128);
+	bus.attach(0x20, &regs);
+	for (int i = 0; i < 128; i++)
+		regs.getRegisters()[i] = i;
+
+	I2C handle;
+	handle.open(&bus, 0x20, true);
+
+	// The worker blocks on the bus lock, so everything queued while it is
+	// held is executed after it is released
+	const int num = 16;
+	uint8_t out[num][2];
+	std::vector<std::future<int> > results;
+	std::unique_lock<std::recursive_mutex> hold(bus.getLock());
+	for (int i = 0; i < num; i++)
+	{
+		handle.beginTransaction();
+		handle.readRegister(i, out[i], 2);
+		results.push_back(handle.submit());
+	}
+	hold.unlock();
+	bool ok = true;
+	for (int i = 0; i < num; i++)
+		ok = ok && results[i].get() == 3 && out[i][0] == i
+				&& out[i][1] == i + 1;
+	check(ok, "queued transactions complete with their results");
+	check(bus.getStats().transfers <= 2, "queued transactions are batched");
+
+	// A failing device only fails its own transactions, and nothing that
+	// already reached the bus is sent again
+	EEPROM24CXModel model(EEPROM_2K, EEPROM_8_PAGE, EEPROM_8_ADDR);
+	model.setBusyPolls(0);
+	bus.attach(0x50, &model);
+	I2C eeprom, absent;
+	eeprom.open(&bus, 0x50, true);
+	absent.open(&bus, 0x51, true);
+	bus.resetStats();
+
+	uint8_t pair[2] =
+	{ 0x10, 0xAA }, one[1];
+	hold.lock();
+	eeprom.beginTransaction();
+	eeprom.write(pair, 2);
+	std::future<int> written = eeprom.submit();
+	absent.beginTransaction();
+	absent.read(one, 1);
+	std::future<int> failed = absent.submit();
+	hold.unlock();
+
+	check(written.get() == 2, "transaction of another client is not failed");
+	check(failed.get() == -ENXIO, "failing device reports its error");
+	check(model.getMemory()[0x10] == 0xAA && model.getStats().pageWrites == 1,
+			"write is not repeated");
+	check(bus.getStats().transfers == 2, "clients are not packed together");
+
+	// Clients that share batches are packed behind the transaction in
+	// progress, and all fail together
+	eeprom.setSharedBatches(true);
+	absent.setSharedBatches(true);
+	bus.resetStats();
+
+	uint8_t reg[2], pair2[2] =
+	{ 0x20, 0x55 };
+	hold.lock();
+	handle.beginTransaction();
+	handle.readRegister(0, reg, 2);
+	std::future<int> ahead = handle.submit();
+	eeprom.beginTransaction();
+	eeprom.write(pair2, 2);
+	written = eeprom.submit();
+	absent.beginTransaction();
+	absent.read(one, 1);
+	failed = absent.submit();
+	hold.unlock();
+
+	check(ahead.get() == 3, "transaction of a client that does not share succeeds");
+	int rw = written.get(), rf = failed.get();
+	check(rw == -ECANCELED && rf == -ECANCELED,
+			"failed shared batch is cancelled for all clients");
+	check(model.getMemory()[0x20] == 0x55 && model.getStats().pageWrites == 2,
+			"failed shared batch is not repeated");
+	check(bus.getStats().transfers == 2, "sharing clients are packed together");
+}
+
+int main()
+{
+	testPageSplit();
+	testBoundaries();
+	testQueue();
+
+	if (failures)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * spi_bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <vector>
+
+#include "SPIBenchmark.h"
+#include "SPIModel.h"
+#include "GPIOoo.h"
+#include "debug.h"
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+					"  -b bus        SPI bus (default 1)\n"
+					"  -c channel    SPI channel (default 0)\n"
+					"  -l            use a loopback device model instead of spidev\n"
+					"  -s speeds     clock speeds in Hz (default 1000000,8000000,24000000)\n"
+					"  -w bpws       bits per word (default 8)\n"
+					"  -z sizes      transfer sizes in bytes (default 1,4,16,...,65536)\n"
+					"  -m segments   also run each size split in this many segments\n"
+					"  -t threads    thread counts for the contention runs (default 1)\n"
+					"  -n count      operations per thread (default 1000)\n"
+					"  -g pin        drive this GPIO as chip select around each operation\n",
+			name);
+}
+
+static std::vector<uint32_t> parseList(const char *arg)
+{
+	std::vector<uint32_t> list;
+	char *end;
+	while (*arg)
+	{
+		list.push_back(strtoul(arg, &end, 0));
+		if (end == arg)
+			break;
+		arg = *end == ',' ? end + 1 : end;
+	}
+	return list;
+}
+
+int main(int argc, char *argv[])
+{
+	int bus = 1;
+	int channel = 0;
+	bool loopback = false;
+	int segments = 1;
+	int iterations = 1000;
+	const char *cspin = nullptr;
+	std::vector<uint32_t> speeds = { 1000000, 8000000, 24000000 };
+	std::vector<uint32_t> bpws = { 8 };
+	std::vector<uint32_t> sizes = { 1, 4, 16, 64, 256, 1024, 4096, 16384,
+			65536 };
+	std::vector<uint32_t> threads = { 1 };
+
+	int opt;
+	while ((opt = getopt(argc, argv, "b:c:ls:w:z:m:t:n:g:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				bus = atoi(optarg);
+				break;
+			case 'c':
+				channel = atoi(optarg);
+				break;
+			case 'l':
+				loopback = true;
+				break;
+			case 's':
+				speeds = parseList(optarg);
+				break;
+			case 'w':
+				bpws = parseList(optarg);
+				break;
+			case 'z':
+				sizes = parseList(optarg);
+				break;
+			case 'm':
+				segments = atoi(optarg);
+				break;
+			case 't':
+				threads = parseList(optarg);
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			case 'g':
+				cspin = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	SPILoopbackModel model;
+	SPIModelTransport modelTransport(&model, SPI::Profile(0, 8, false, speeds[0]));
+
+	SPIBenchmark bench;
+	int r = bench.open(bus, channel, loopback ? &modelTransport : nullptr);
+	if (r < 0)
+	{
+		fprintf(stderr, "Can not open SPI bus %d, channel %d: %s\n", bus, channel,
+				strerror(-r));
+		return 1;
+	}
+
+	GPIOpin *cs = nullptr;
+	if (cspin != nullptr)
+	{
+		char *names[] = { (char *) cspin };
+		cs = GPIOoo::getInstance()->claim(names, 1);
+		if (cs == nullptr)
+		{
+			fprintf(stderr, "Can not claim GPIO %s\n", cspin);
+			return 1;
+		}
+		cs->setBit(0);
+		bench.setChipSelect(cs, 0, 0);
+	}
+
+	SPIBenchmark::printHeader(stdout);
+	for (size_t sp = 0; sp < speeds.size(); sp++)
+		for (size_t bp = 0; bp < bpws.size(); bp++)
+			for (size_t th = 0; th < threads.size(); th++)
+				for (size_t sz = 0; sz < sizes.size(); sz++)
+				{
+					SPIBenchmark::Case test(sizes[sz], speeds[sp], bpws[bp], 1, true,
+							threads[th], iterations);
+					SPIBenchmark::Result result;
+
+					bench.run(test, result);
+					SPIBenchmark::print(stdout, result);
+					if (segments > 1)
+					{
+						// Same data in several pieces, as one message and as separate calls
+						test.segments = segments;
+						bench.run(test, result);
+						SPIBenchmark::print(stdout, result);
+						test.batched = false;
+						bench.run(test, result);
+						SPIBenchmark::print(stdout, result);
+					}
+					fflush(stdout);
+				}
+
+	bench.close();
+	if (cs != nullptr)
+		GPIOoo::getInstance()->release(&cs);
+	return 0;
+}
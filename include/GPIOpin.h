@@ -25,6 +25,26 @@ class GPIOpin
 		}
 		;
 	public:
+		/**
+		 * Snapshot of direction and output state of the lines in the block.
+		 * Bit i of each field describes the i-th line of the block.
+		 */
+		struct State
+		{
+				uint32_t outputs; //!< Lines with output buffers enabled
+				uint32_t values; //!< Values latched in the output registers
+
+				bool operator==(const State &s) const
+				{
+					return outputs == s.outputs && values == s.values;
+				}
+				;
+				bool operator!=(const State &s) const
+				{
+					return !(*this == s);
+				}
+				;
+		};
 
 		virtual ~GPIOpin()
 		{
@@ -104,6 +124,21 @@ class GPIOpin
 		 */
 		virtual uint32_t read()=0;
 
+		/**
+		 * Method captures direction and output values of all lines in the block.
+		 * Snapshots can be compared to detect changes made since the capture.
+		 * @param state
+		 */
+		virtual void saveState(State &state)=0;
+
+		/**
+		 * Method restores direction and output values captured by saveState().
+		 * Output values are restored before output buffers are enabled, so lines
+		 * switched to output mode start driving the restored value.
+		 * @param state
+		 */
+		virtual void restoreState(const State &state)=0;
+
 		/**
 		 * Method returns true of the block describes a valid set of GPIO lines.
 		 * If method returns false, the block is useless and should not be expected to perform any operations.
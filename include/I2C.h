@@ -6,17 +6,35 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
 #include <vector>
+#include <type_traits>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <functional>
 #include <linux/i2c.h>
+#include <linux/i2c-dev.h>
 
 #include "debug.h"
+#include "I2CBus.h"
 
 #ifndef I2C_H_
 #define I2C_H_
 
+#ifndef I2C_RDWR_IOCTL_MAX_MSGS
+#define I2C_RDWR_IOCTL_MAX_MSGS 42
+#endif
+
+// Bytes per transaction for joining register writes without the heap
+#ifndef I2C_SCRATCH_SIZE
+#define I2C_SCRATCH_SIZE 256
+#endif
+
 class I2C
 {
 public:
@@ -25,15 +43,152 @@ public:
 	};
 
 private:
-	int activeBus;
+	friend class I2CQueue;
+
+	// Held by every call, and by the thread in a transaction until it ends
+	std::recursive_mutex lock;
+
+	// Asynchronous transactions submitted and not completed yet, guarded by
+	// pendingLock; idle is signalled when the count drops to zero
+	int pending;
+	std::mutex pendingLock;
+	std::condition_variable idle;
+
+	I2CBus *bus;
 	int activeAddr;
-	int fd;
-	unsigned long supportedFuncs;
 	bool tenbit;
 	byte_order byteOrder = MSB_first;
+	bool sharedBatches = false;
 
 	bool transactionState;
-	std::vector<struct i2c_msg> msgs;
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	int numMsgs;
+
+	// Buffers that must live until the transaction is committed
+	unsigned char scratch[I2C_SCRATCH_SIZE];
+	size_t scratchUsed;
+	std::vector<unsigned char *> heapBuffers;
+
+	/*
+	 * Queues a message to the active address
+	 *
+	 * @return The message, or NULL if the transaction is full.
+	 * 			errno is updated.
+	 */
+	struct i2c_msg *addMessage(void *buf, size_t length, unsigned short flags,
+			bool showErrors);
+
+	/*
+	 * @return Buffer valid until the transaction ends. Comes from the
+	 * 			scratch area, or from the heap if that is used up.
+	 */
+	unsigned char *allocBuffer(size_t length);
+
+	/*
+	 * Forgets queued messages and buffers
+	 */
+	void resetTransaction();
+
+	/*
+	 * Queues a message, and commits it right away outside a transaction
+	 *
+	 * @return Number of bytes transferred, 0 in a transaction, or -1
+	 * 			on error.
+	 * 			errno is updated.
+	 */
+	int queue(void *buf, size_t length, unsigned short flags,
+			bool showErrors);
+
+	/*
+	 * Copies data to be written, reversed if the device is LSB_first
+	 */
+	void orderedCopy(unsigned char *dst, const void *src, size_t length);
+
+	/*
+	 * @return The data to be written in device order. Either buf or a
+	 * 			buffer valid until the transaction ends.
+	 */
+	void *ordered(const void *buf, size_t length);
+
+	/*
+	 * Reads registers without changing the byte order, through the SMBus
+	 * or I2C_RDWR as the bus prefers
+	 */
+	int readRaw(unsigned char regAddr, void *rbuf, size_t length,
+			bool showErrors);
+
+	/*
+	 * Writes registers outside a transaction, through the SMBus or
+	 * I2C_RDWR as the bus prefers. Releases the scratch area.
+	 *
+	 * @param frame Register address followed by the data, in device order
+	 * @param length Number of data bytes
+	 */
+	int writeRaw(unsigned char *frame, size_t length, bool showErrors);
+
+	/*
+	 * Accesses registers with an SMBus transaction
+	 *
+	 * @return length, or -1 on error. errno is EOPNOTSUPP if the
+	 * 			access has no SMBus equivalent on this adapter.
+	 */
+	int smbusAccess(char readWrite, unsigned char command,
+			unsigned char *buf, size_t length);
+
+	/*
+	 * Hands the current transaction over to the queue of the bus
+	 *
+	 * @return negative errno on failure
+	 */
+	int queueRequest(int priority, std::function<void(int)> callback,
+			std::future<int> *result);
+
+	/*
+	 * @return Value with its bytes reversed
+	 */
+	template<typename T>
+	static T byteSwap(T v)
+	{
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4
+				|| sizeof(T) == 8, "Registers must be 1, 2, 4 or 8 bytes");
+
+		if (sizeof(T) == 2)
+		{
+			uint16_t u;
+			memcpy(&u, &v, 2);
+			u = __builtin_bswap16(u);
+			memcpy(&v, &u, 2);
+		}
+		else if (sizeof(T) == 4)
+		{
+			uint32_t u;
+			memcpy(&u, &v, 4);
+			u = __builtin_bswap32(u);
+			memcpy(&v, &u, 4);
+		}
+		else if (sizeof(T) == 8)
+		{
+			uint64_t u;
+			memcpy(&u, &v, 8);
+			u = __builtin_bswap64(u);
+			memcpy(&v, &u, 8);
+		}
+		return v;
+	}
+
+	/*
+	 * @return true if values of type T have to be swapped between
+	 * 			host and device order
+	 */
+	template<typename T>
+	bool needsSwap()
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return sizeof(T) > 1 && byteOrder == MSB_first;
+#else
+		return sizeof(T) > 1 && byteOrder == LSB_first;
+#endif
+	}
 
 protected:
 	/*
@@ -61,9 +216,21 @@ public:
 	 */
 	I2C(int bus, int slaveAddr);
 
+	/**
+	 * Convenience constructor for a device on a bus opened by the caller
+	 *
+	 * @param bus The bus the device is connected to. Not owned.
+	 * @param slaveAddr Address of the device to communicate with on the bus
+	 * 					Can be either a 7-bit or a 10-bit address
+	 */
+	I2C(I2CBus *bus, int slaveAddr);
+
 	/**
 	 * Initializes an I2C bus for reading and writing
 	 *
+	 * The adapter is shared with all other I2C instances on the same
+	 * bus, see I2CBus::acquire().
+	 *
 	 * @param bus The bus of which the I2C bus is connected.
 	 * 				On the BeagleBoard, this is one of
 	 * 				0 = I2C0, 2 = I2C1, 1 = I2C2
@@ -75,10 +242,25 @@ public:
 	int open(int bus);
 
 	/**
-	 * Sets the destination address for all communications on this bus
+	 * Uses a bus opened by the caller for reading and writing
+	 *
+	 * @param bus The bus the device is connected to. Not owned, it
+	 * 				must stay open while this instance uses it.
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	int open(I2CBus *bus);
 
+	/**
+	 * Sets the destination address for all communications on this bus
+	 *
+	 * The address is sent with every message, so no ioctl is needed and
+	 * several instances can talk to different devices on one bus.
+	 *
 	 * @param slaveAddr Address of the device to communicate with on the bus
-	 * 					Can be either a 7-bit or a 10-bit address
+	 * 					Can be either a 7-bit address (0x08 to 0x77)
+	 * 					or a 10-bit address (0x80 to 0x3FF)
 	 * @param ignoreChecks If set to true, the slave will not be probed to
 	 * 					check for an online device.
 	 * 					Default is false.
@@ -106,6 +288,16 @@ public:
 	 */
 	int open(int bus, int slaveAddr, bool ignoreChecks = false);
 
+	/**
+	 * Opens a device on a bus opened by the caller
+	 *
+	 * Shorthand for #open(bus) #setSlave(address)
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	int open(I2CBus *bus, int slaveAddr, bool ignoreChecks = false);
+
 	/**
 	 * Closes the I2C instance
 	 *
@@ -151,6 +343,11 @@ public:
 	 */
 	int getActiveAddress();
 
+	/*
+	 * @return Bus in use, or NULL
+	 */
+	I2CBus *getBus();
+
 	/**
 	 * Get the order of the bytes the devices expect
 	 * to be sent and received with.
@@ -207,6 +404,8 @@ public:
 	 * Writes n bytes to the I2C device\
 	 *
 	 * @param wbuf[] Character buffer to write from (big-endian).
+	 * 				It is not modified; if the device is LSB_first, a
+	 * 				reversed copy is sent.
 	 * @param length Number of bytes to write.
 	 * @param ignoreNack If set to true, the master will not require
 	 * 						a read acknowledgment from the slave.
@@ -269,7 +468,10 @@ public:
 	 * Convenience function for sending a sending two writes combined
 	 * into a single write.
 	 *
-	 * There is no reset between the writes.
+	 * There is no reset between the writes. If the adapter supports
+	 * I2C_FUNC_NOSTART, the buffers are sent as two messages joined with
+	 * I2C_M_NOSTART; otherwise they are copied together, into a scratch
+	 * area for short writes.
 	 *
 	 * @param w1buf[] Character buffer to write from in first write (big-endian).
 	 * @param w1length Number of bytes to write in first write.
@@ -338,6 +540,115 @@ public:
 	int writeRegister(unsigned char regAddr, const void *wbuf, size_t length,
 			bool showErrors = true);
 
+	/**
+	 * Reads consecutive registers holding values of type T.
+	 *
+	 * The device's byte order (see #setByteOrder()) is converted to the
+	 * host's in place, with no extra copy. Reads cannot be part of a
+	 * transaction, as the values are converted when they arrive.
+	 *
+	 * @param regAddr The address of the first register.
+	 * @param values Array to read into.
+	 * @param count Number of values to read.
+	 * @param showErrors If set to false, errors will not be displayed.
+	 * 					Defaults to true.
+	 *
+	 * @return Number of values read, or -1 for error.
+	 * 			errno is updated.
+	 */
+	template<typename T, typename = typename std::enable_if<
+			std::is_arithmetic<T>::value>::type>
+	int readRegisters(unsigned char regAddr, T *values, size_t count,
+			bool showErrors = true)
+	{
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		if (readRaw(regAddr, values, count * sizeof(T), showErrors) < 0)
+			return -1;
+
+		if (needsSwap<T>())
+			for (size_t i = 0; i < count; i++)
+				values[i] = byteSwap(values[i]);
+		return count;
+	}
+
+	/**
+	 * Reads a register holding a value of type T,
+	 * e.g. readRegister<uint16_t>(0x10, value).
+	 *
+	 * @see #readRegisters()
+	 *
+	 * @return 1 on success, or -1 for error.
+	 * 			errno is updated.
+	 */
+	template<typename T, typename = typename std::enable_if<
+			std::is_arithmetic<T>::value>::type>
+	int readRegister(unsigned char regAddr, T &value, bool showErrors = true)
+	{
+		return readRegisters(regAddr, &value, 1, showErrors);
+	}
+
+	/**
+	 * Writes consecutive registers holding values of type T.
+	 *
+	 * The values are converted to the device's byte order while they are
+	 * copied behind the register address, so the caller's array is not
+	 * modified. Can be part of a transaction.
+	 *
+	 * @param regAddr The address of the first register.
+	 * @param values Values to write.
+	 * @param count Number of values to write.
+	 * @param showErrors If set to false, errors will not be displayed.
+	 * 					Defaults to true.
+	 *
+	 * @return Number of values written, or -1 for error.
+	 * 			If called in the middle of a transaction, the function
+	 * 			will return 0 on success.
+	 * 			errno is updated.
+	 */
+	template<typename T, typename = typename std::enable_if<
+			std::is_arithmetic<T>::value>::type>
+	int writeRegisters(unsigned char regAddr, const T *values, size_t count,
+			bool showErrors = true)
+	{
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		if (!isReady())
+			return -1;
+
+		unsigned char *buf = allocBuffer(1 + count * sizeof(T));
+		buf[0] = regAddr;
+		bool swap = needsSwap<T>();
+		for (size_t i = 0; i < count; i++)
+		{
+			T v = swap ? byteSwap(values[i]) : values[i];
+			memcpy(buf + 1 + i * sizeof(T), &v, sizeof(T));
+		}
+
+		int rc = transactionState ?
+				queue(buf, 1 + count * sizeof(T), 0, showErrors) :
+				writeRaw(buf, count * sizeof(T), showErrors);
+		if (rc <= 0)
+			return rc;
+		return count;
+	}
+
+	/**
+	 * Writes a register holding a value of type T,
+	 * e.g. writeRegister<int32_t>(0x10, value).
+	 *
+	 * @see #writeRegisters()
+	 *
+	 * @return 1 on success, or -1 for error.
+	 * 			If called in the middle of a transaction, the function
+	 * 			will return 0 on success.
+	 * 			errno is updated.
+	 */
+	template<typename T, typename = typename std::enable_if<
+			std::is_arithmetic<T>::value>::type>
+	int writeRegister(unsigned char regAddr, T value, bool showErrors = true)
+	{
+		return writeRegisters(regAddr, &value, 1, showErrors);
+	}
+
 	/**
 	 * Begin a transaction for all following I2C commands
 	 *
@@ -345,6 +656,9 @@ public:
 	 * #end_transaction() is called, where all reads and writes will be committed
 	 * in order.
 	 *
+	 * Other threads using this instance wait until the transaction
+	 * is ended, aborted or submitted.
+	 *
 	 * @param showErrors If set to false, errors will not be displayed.
 	 * 					Defaults to true.
 	 * 					Errors will not display if IOOO_ERROR_LEVEL is 0
@@ -382,6 +696,60 @@ public:
 	 */
 	void abortTransaction(bool showErrors = true);
 
+	/**
+	 * Commits the current transaction asynchronously
+	 *
+	 * The transaction is executed by the worker thread of the bus,
+	 * possibly in one ioctl with other transactions of this instance, and
+	 * this instance returns to normal read/write mode at once. Data
+	 * written from the scratch area is kept with the transaction, but
+	 * buffers of the caller must stay valid until it completes.
+	 * Adapters without I2C_FUNC_I2C are not supported.
+	 *
+	 * If the ioctl fails, every transaction packed into it gets the error,
+	 * even if it reached the device before the failing message. Use
+	 * #endTransaction() where the exact outcome of each transaction matters.
+	 * See #setSharedBatches() for packing with other instances.
+	 *
+	 * @param priority Transactions with higher priority are executed first
+	 *
+	 * @return Future receiving the number of bytes written and read,
+	 * 			or a negative error code
+	 */
+	std::future<int> submit(int priority = 0);
+
+	/**
+	 * Commits the current transaction asynchronously
+	 *
+	 * The callback is called from the worker thread of the bus with the
+	 * number of bytes written and read, or a negative error code. It must
+	 * not call #flush() or #close().
+	 *
+	 * @param callback Completion callback
+	 * @param priority Transactions with higher priority are executed first
+	 *
+	 * @return negative on failure to queue the transaction
+	 */
+	int submit(std::function<void(int)> callback, int priority = 0);
+
+	/**
+	 * Allows submitted transactions to be packed into one ioctl with those
+	 * of other instances that allow it too.
+	 *
+	 * If such a shared ioctl fails, it is not known which device caused
+	 * the error, and all of its transactions complete with -ECANCELED.
+	 * Messages before the failure may have reached their devices.
+	 *
+	 * Default is false
+	 */
+	void setSharedBatches(bool enable);
+
+	/**
+	 * Waits until all transactions submitted by this instance complete.
+	 * Called by #close().
+	 */
+	void flush();
+
 	/**
 	 * Destructor for I2C class
 	 */
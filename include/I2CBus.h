@@ -0,0 +1,213 @@
+/*
+ * I2CBus.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef I2CBUS_H_
+#define I2CBUS_H_
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <linux/i2c.h>
+
+class I2CQueue;
+
+/**
+ * @brief An I2C adapter, opened once and shared by the devices on it.
+ *
+ * The bus owns the file descriptor of the adapter. Every message carries
+ * its own slave address, so any number of I2C handles can use the same bus
+ * without switching the address with ioctl(I2C_SLAVE) in between.
+ *
+ * Buses opened through #acquire() are shared by bus number and closed when
+ * the last handle releases them. Other buses are owned by the application.
+ *
+ * Register accesses can also go through the SMBus ioctl, which is the only
+ * way to reach devices on adapters without I2C_FUNC_I2C. The bus decides
+ * once which path register accesses take, see #useSMBus().
+ *
+ * Threads share a bus through its lock, which callers of #transfer() and
+ * #smbus() hold. Transactions submitted asynchronously are executed by the
+ * worker thread of the bus, see I2C::submit().
+ */
+class I2CBus
+{
+private:
+	static std::mutex registryLock;
+	static std::map<int, I2CBus *> registry;
+
+	int users;
+	bool shared;
+	I2CQueue *queue;
+
+protected:
+	int busNum;
+	int fd;
+	unsigned long supportedFuncs;
+	bool smbusPreferred;
+	int slaveAddr; //!< Address last set with ioctl(I2C_SLAVE), for SMBus
+	bool slaveTenbit;
+	std::recursive_mutex lock;
+
+public:
+	I2CBus();
+
+	/**
+	 * Opens an I2C adapter
+	 *
+	 * @param bus The bus of which the I2C bus is connected.
+	 * 				On the BeagleBoard, this is one of
+	 * 				0 = I2C0, 2 = I2C1, 1 = I2C2
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	int open(int bus);
+
+	/**
+	 * Closes the adapter
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	int close();
+
+	/**
+	 * @return true if the bus is open
+	 */
+	bool isOpen()
+	{
+		return busNum >= 0;
+	}
+
+	/**
+	 * @return Bus number, or -1 if the bus is not open
+	 */
+	int getBus()
+	{
+		return busNum;
+	}
+
+	/**
+	 * @return File descriptor of the adapter, or -1 if there is none
+	 */
+	int getFd()
+	{
+		return fd;
+	}
+
+	/**
+	 * @return Functionality of the adapter (I2C_FUNC_*)
+	 */
+	unsigned long getFuncs()
+	{
+		return supportedFuncs;
+	}
+
+	/**
+	 * Lock held around every transfer on the bus. Holding it keeps
+	 * several transfers together, e.g. behind a mux channel selection.
+	 */
+	std::recursive_mutex &getLock()
+	{
+		return lock;
+	}
+
+	/**
+	 * @return Submission queue of the bus
+	 */
+	I2CQueue *getQueue()
+	{
+		return queue;
+	}
+
+	/**
+	 * Performs a combined transfer, with a repeated start between
+	 * messages and a stop after the last one. The caller holds
+	 * #getLock().
+	 *
+	 * @param msgs Messages, each with its own slave address and flags
+	 * @param num Number of messages
+	 *
+	 * @return Number of messages transferred, or -1 on error.
+	 * 			errno is updated.
+	 */
+	virtual int transfer(struct i2c_msg *msgs, int num);
+
+	/**
+	 * Performs an SMBus transaction. The slave address of the adapter is
+	 * only changed when it differs from the last one used. The caller
+	 * holds #getLock().
+	 *
+	 * @param addr Slave address
+	 * @param tenbit The address is a 10-bit address
+	 * @param readWrite I2C_SMBUS_READ or I2C_SMBUS_WRITE
+	 * @param command Command or register address
+	 * @param size Transaction type, e.g. I2C_SMBUS_BYTE_DATA
+	 * @param data Data to send or buffer for received data
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	virtual int smbus(int addr, bool tenbit, char readWrite, uint8_t command,
+			int size, union i2c_smbus_data *data);
+
+	/**
+	 * @return true if register accesses should use SMBus transactions.
+	 * 			Set when the adapter lacks I2C_FUNC_I2C, or when it turns
+	 * 			out not to implement I2C_RDWR.
+	 */
+	bool useSMBus()
+	{
+		return smbusPreferred;
+	}
+
+	/**
+	 * Selects the path of register accesses. SMBus can be cheaper on
+	 * adapters with native SMBus support; accesses the SMBus cannot
+	 * express still use I2C_RDWR.
+	 *
+	 * @param prefer Use SMBus transactions where possible
+	 */
+	void setSMBus(bool prefer)
+	{
+		smbusPreferred = prefer;
+	}
+
+	/**
+	 * Looks up an adapter by name in sysfs, e.g. "SMBus stub driver"
+	 * for the kernel's i2c-stub module (modprobe i2c-stub chip_addr=0x50).
+	 *
+	 * @param name Adapter name
+	 *
+	 * @return Bus number, or -1 on error.
+	 * 			errno is updated.
+	 */
+	static int find(const char *name);
+
+	/**
+	 * Returns the shared bus with the given number, opening it
+	 * if no handle uses it yet.
+	 *
+	 * @param bus Bus number
+	 *
+	 * @return The bus, or NULL on error.
+	 * 			errno is updated.
+	 */
+	static I2CBus *acquire(int bus);
+
+	/**
+	 * Gives back a bus returned by #acquire(). The bus is closed when
+	 * it is no longer used. Buses not obtained from #acquire() are
+	 * left alone.
+	 *
+	 * @param bus
+	 */
+	static void release(I2CBus *bus);
+
+	virtual ~I2CBus();
+};
+
+#endif /* I2CBUS_H_ */
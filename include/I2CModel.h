@@ -0,0 +1,348 @@
+/*
+ * I2CModel.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef I2CMODEL_H_
+#define I2CMODEL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <set>
+
+#include "I2CBus.h"
+
+/**
+ * @brief Userspace model of a device on an I2C bus.
+ * A model sees the bus as the device would: start conditions with its
+ * address, the bytes of the master and stop conditions. It is attached to
+ * an I2CEmulatedBus, so drivers can be run and measured without hardware.
+ */
+class I2CDeviceModel
+{
+	public:
+		virtual ~I2CDeviceModel()
+		{
+		}
+		;
+
+		/**
+		 * Called for a start or repeated start with the address of the device.
+		 * @param read Direction of the transfer that follows
+		 * @return false to NACK the address
+		 */
+		virtual bool start(bool /*read*/)
+		{
+			return true;
+		}
+		;
+
+		/**
+		 * Called for each byte the master writes.
+		 * @param byte
+		 * @return false to NACK the byte
+		 */
+		virtual bool write(uint8_t byte) = 0;
+
+		/**
+		 * Called for each byte the master reads.
+		 * @return The byte
+		 */
+		virtual uint8_t read() = 0;
+
+		/**
+		 * Called for a stop condition after the device was addressed.
+		 */
+		virtual void stop()
+		{
+		}
+		;
+};
+
+/**
+ * @brief Model of a device with 8-bit register addresses.
+ * The first byte of a write sets the register pointer, further bytes are
+ * written to consecutive registers. Reads start at the pointer. The pointer
+ * wraps at the end of the register file.
+ */
+class I2CRegisterModel: public I2CDeviceModel
+{
+	private:
+		std::vector<uint8_t> regs;
+		uint8_t pointer;
+		bool first;
+	public:
+		/**
+		 * @param numRegs Number of registers, at most 256
+		 * @param fill Initial value of the registers
+		 */
+		I2CRegisterModel(unsigned int numRegs = 256, uint8_t fill = 0);
+
+		/**
+		 * @return Contents of the register file.
+		 */
+		std::vector<uint8_t> &getRegisters()
+		{
+			return regs;
+		}
+		;
+
+		virtual bool start(bool read);
+		virtual bool write(uint8_t byte);
+		virtual uint8_t read();
+};
+
+/**
+ * @brief Model of a 24-series I2C EEPROM.
+ * A write starts with 1 or 2 address bytes. Data bytes are buffered and
+ * wrap within the page, as on the real part, and are programmed at the stop
+ * condition. During the write cycle the part NACKs its address for a set
+ * number of attempts. Reads continue from the address and wrap at the end
+ * of the memory.
+ */
+class EEPROM24CXModel: public I2CDeviceModel
+{
+	public:
+		struct Stats
+		{
+				uint64_t reads; //!< Bytes read
+				uint64_t pageWrites; //!< Write cycles
+				uint64_t busyNacks; //!< Addresses NACKed during write cycles
+
+				Stats() :
+						reads(0), pageWrites(0), busyNacks(0)
+				{
+				}
+				;
+		};
+
+	private:
+		std::vector<uint8_t> memory;
+		uint32_t pageSize;
+		int addressBytes;
+		uint32_t busyPolls;
+
+		uint32_t busy; //!< Address NACKs left before the write cycle ends
+		uint32_t addr;
+		int position; //!< Bytes received since the start
+		std::vector<uint8_t> page;
+		std::vector<bool> pageUsed;
+		Stats stats;
+	public:
+		/**
+		 * @param size Size in bytes
+		 * @param pageSize Page size in bytes
+		 * @param addressBytes Number of address bytes, 1 or 2
+		 */
+		EEPROM24CXModel(uint32_t size, uint32_t pageSize, int addressBytes);
+
+		/**
+		 * Sets how many address attempts a write cycle is NACKed for.
+		 * @param polls
+		 */
+		void setBusyPolls(uint32_t polls);
+
+		/**
+		 * @return Contents of the memory array.
+		 */
+		std::vector<uint8_t> &getMemory()
+		{
+			return memory;
+		}
+		;
+
+		Stats getStats()
+		{
+			return stats;
+		}
+		;
+
+		virtual bool start(bool read);
+		virtual bool write(uint8_t byte);
+		virtual uint8_t read();
+		virtual void stop();
+};
+
+/**
+ * @brief Model of an LTC2485 24-bit delta-sigma ADC.
+ * A write sets the configuration byte. A read returns the 32-bit result
+ * word of the last conversion: sign, MSB and 24 bits of offset binary
+ * data, with overrange and underrange codes at full scale. Reading the
+ * result starts the next conversion, for which the address is NACKed a set
+ * number of times. The configuration byte is kept but not interpreted.
+ */
+class LTC2485Model: public I2CDeviceModel
+{
+	private:
+		double vref;
+		double input;
+		uint32_t conversionPolls;
+
+		uint8_t config;
+		uint32_t busy; //!< Address NACKs left before the conversion ends
+		uint8_t result[4];
+		int position;
+		bool reading;
+
+		void convert();
+	public:
+		/**
+		 * @param vref Reference voltage; full scale is +-vref/2
+		 */
+		LTC2485Model(double vref = 5.0);
+
+		/**
+		 * Sets the differential input voltage of the next conversions.
+		 * @param volts
+		 */
+		void setInput(double volts);
+
+		/**
+		 * Sets how many address attempts a conversion is NACKed for.
+		 * @param polls
+		 */
+		void setConversionPolls(uint32_t polls);
+
+		/**
+		 * @return Last configuration byte written.
+		 */
+		uint8_t getConfig()
+		{
+			return config;
+		}
+		;
+
+		virtual bool start(bool read);
+		virtual bool write(uint8_t byte);
+		virtual uint8_t read();
+		virtual void stop();
+};
+
+/**
+ * @brief I2C bus routing transfers to device models.
+ * The bus behaves like an I2C adapter opened from /dev/i2c-N: I2C_RDWR
+ * transfers with repeated starts, I2C_M_NOSTART, I2C_M_STOP,
+ * I2C_M_IGNORE_NAK and I2C_M_RECV_LEN, and SMBus transactions emulated with
+ * I2C messages the way the kernel does it. A NACK ends the transfer with
+ * ENXIO for an address and EREMOTEIO for data, as most adapters report.
+ *
+ * The functionality can be restricted with setFuncs(), e.g. to the SMBus
+ * functions of the kernel's i2c-stub module, which has no I2C_RDWR.
+ *
+ * Each transfer is timed as it would be at the set clock speed, plus a
+ * fixed overhead per ioctl. The time is counted, and with setRealTime()
+ * also spent, so benchmarks see the throughput of a real bus.
+ * Counters are updated under the bus lock.
+ */
+class I2CEmulatedBus: public I2CBus
+{
+	public:
+		struct Stats
+		{
+				uint64_t transfers; //!< I2C_RDWR ioctls
+				uint64_t smbusCalls; //!< I2C_SMBUS ioctls
+				uint64_t messages; //!< Messages, including emulated SMBus ones
+				uint64_t bytes; //!< Data bytes, without addresses
+				uint64_t nacks; //!< NACKed addresses and bytes
+				uint64_t busTime; //!< Time the traffic takes on a real bus, in ns
+
+				Stats() :
+						transfers(0), smbusCalls(0), messages(0), bytes(0), nacks(
+								0), busTime(0)
+				{
+				}
+				;
+		};
+
+	private:
+		std::map<int, I2CDeviceModel *> models;
+		std::set<I2CDeviceModel *> addressed; //!< Models that have not seen a stop
+		uint32_t speed;
+		uint32_t overhead;
+		bool realTime;
+		Stats stats;
+
+		I2CEmulatedBus(const I2CEmulatedBus &) = delete;
+		I2CEmulatedBus &operator=(const I2CEmulatedBus &) = delete;
+
+		/**
+		 * Runs messages through the models and times them.
+		 * @return num, or -1 with errno set
+		 */
+		int execute(struct i2c_msg *msgs, int num);
+		int route(struct i2c_msg *msgs, int num, uint64_t &bits);
+		void stopAll();
+		void spend(uint64_t ns);
+	public:
+		/**
+		 * Functionality of the kernel's i2c-stub module, for setFuncs().
+		 */
+		static const unsigned long StubFuncs = I2C_FUNC_SMBUS_QUICK
+				| I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA
+				| I2C_FUNC_SMBUS_WORD_DATA | I2C_FUNC_SMBUS_BLOCK_DATA
+				| I2C_FUNC_SMBUS_I2C_BLOCK;
+
+		/**
+		 * @param bus Bus number reported by getBus()
+		 * @param speed Clock speed in Hz, 0 for no timing
+		 */
+		I2CEmulatedBus(int bus = 0, uint32_t speed = 100000);
+		virtual ~I2CEmulatedBus();
+
+		/**
+		 * Puts a device model on the bus.
+		 * @param addr 7-bit or 10-bit address
+		 * @param model Device model, not owned
+		 */
+		void attach(int addr, I2CDeviceModel *model);
+
+		/**
+		 * Removes the device at an address.
+		 * @param addr
+		 */
+		void detach(int addr);
+
+		/**
+		 * Sets the timing of transfers.
+		 * @param speed Clock speed in Hz, e.g. 100000 or 400000; 0 for no timing
+		 * @param overhead Time per ioctl in ns, for the kernel and the adapter
+		 */
+		void setTiming(uint32_t speed, uint32_t overhead = 0);
+
+		/**
+		 * Makes transfers take as long as on a real bus, by waiting until
+		 * their time has passed.
+		 * @param enable
+		 */
+		void setRealTime(bool enable);
+
+		/**
+		 * Sets the functionality reported to the handles (I2C_FUNC_*).
+		 * Without I2C_FUNC_I2C, I2C_RDWR fails with EOPNOTSUPP.
+		 * @param funcs
+		 */
+		void setFuncs(unsigned long funcs);
+
+		/**
+		 * @return Traffic counters.
+		 */
+		Stats getStats()
+		{
+			return stats;
+		}
+		;
+
+		void resetStats()
+		{
+			stats = Stats();
+		}
+		;
+
+		virtual int transfer(struct i2c_msg *msgs, int num);
+		virtual int smbus(int addr, bool tenbit, char readWrite,
+				uint8_t command, int size, union i2c_smbus_data *data);
+};
+
+#endif /* I2CMODEL_H_ */
@@ -0,0 +1,154 @@
+/*
+ * I2CMux.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef I2CMUX_H_
+#define I2CMUX_H_
+
+#include <stdint.h>
+#include <vector>
+#include <linux/i2c-dev.h>
+
+#include "I2CBus.h"
+
+class I2CMux;
+
+/**
+ * @brief One channel of an I2C multiplexer, used as a bus of its own.
+ *
+ * Devices behind the channel are opened with I2C::open(I2CBus *, int).
+ * Transfers select the channel first if the mux has another one selected.
+ */
+class I2CMuxChannel: public I2CBus
+{
+private:
+	friend class I2CMux;
+
+	I2CMux *mux;
+	int channel;
+
+	I2CMuxChannel(I2CMux *mux, int channel);
+
+public:
+	/**
+	 * @return Mux of the channel
+	 */
+	I2CMux *getMux()
+	{
+		return mux;
+	}
+
+	/**
+	 * @return Channel number
+	 */
+	int getChannel()
+	{
+		return channel;
+	}
+
+	virtual int transfer(struct i2c_msg *msgs, int num);
+	virtual int smbus(int addr, bool tenbit, char readWrite, uint8_t command,
+			int size, union i2c_smbus_data *data);
+
+	virtual ~I2CMuxChannel();
+};
+
+/**
+ * @brief TCA9548A/PCA9548A style I2C multiplexer.
+ *
+ * The mux has a single control register, written with a bit mask of the
+ * channels to connect. Each channel is a virtual bus, see #getChannel().
+ *
+ * The mux remembers the selected channel, so the select write is skipped
+ * while transfers go to the same channel. The mux switches channels at a
+ * stop condition; where the adapter has I2C_FUNC_PROTOCOL_MANGLING, the
+ * select message is sent in the same I2C_RDWR ioctl as the payload,
+ * followed by an I2C_M_STOP. Otherwise it is a separate write, or a send
+ * byte on SMBus-only adapters. The parent bus lock is held across the
+ * select and the payload, so other channels cannot get in between.
+ *
+ * If anything else writes the control register, or the mux is reset,
+ * call #invalidate().
+ */
+class I2CMux
+{
+private:
+	friend class I2CMuxChannel;
+
+	I2CBus *parent;
+	int muxAddr;
+	std::vector<I2CMuxChannel *> channels;
+
+	int selectedMask; //!< Control register value, -1 if unknown
+	unsigned char selectByte;
+	struct i2c_msg batch[I2C_RDWR_IOCTL_MAX_MSGS];
+
+	I2CMux(const I2CMux &) = delete;
+	I2CMux &operator=(const I2CMux &) = delete;
+
+	/*
+	 * Writes the control register. The caller holds the parent lock.
+	 */
+	int writeMask(int mask);
+
+	/*
+	 * Transfers messages on a channel, selecting it in the same ioctl
+	 */
+	int transfer(int channel, struct i2c_msg *msgs, int num);
+
+	/*
+	 * Performs an SMBus transaction on a channel
+	 */
+	int smbus(int channel, int addr, bool tenbit, char readWrite,
+			uint8_t command, int size, union i2c_smbus_data *data);
+
+public:
+	/**
+	 * @param parent Bus the mux is connected to. Not owned, it must stay
+	 * 				open while the mux is used.
+	 * @param addr Address of the mux, 0x70 to 0x77 for the TCA9548A
+	 * @param numChannels Number of channels
+	 */
+	I2CMux(I2CBus *parent, int addr, int numChannels = 8);
+
+	/**
+	 * @param channel Channel number
+	 *
+	 * @return The virtual bus of the channel, owned by the mux,
+	 * 			or NULL if the channel does not exist.
+	 */
+	I2CBus *getChannel(int channel);
+
+	/**
+	 * @return Number of channels
+	 */
+	int getNumChannels()
+	{
+		return channels.size();
+	}
+
+	/**
+	 * @return Selected channel, or -1 if none or unknown
+	 */
+	int getSelected();
+
+	/**
+	 * Disconnects all channels
+	 *
+	 * @return 0 on success or -1 on error.
+	 * 			errno is updated.
+	 */
+	int deselect();
+
+	/**
+	 * Forgets the selected channel, so the next transfer selects
+	 * it again.
+	 */
+	void invalidate();
+
+	virtual ~I2CMux();
+};
+
+#endif /* I2CMUX_H_ */
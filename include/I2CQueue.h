@@ -0,0 +1,112 @@
+/*
+ * I2CQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef I2CQUEUE_H_
+#define I2CQUEUE_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+#include "I2C.h"
+#include "MPSCQueue.h"
+
+/**
+ * @brief Asynchronous submission queue of one I2C bus.
+ * Transactions submitted with I2C::submit() are put on a lock-free queue and
+ * executed by a worker thread owned by the bus. Transactions with higher
+ * priority go first, others in submission order. Queued transactions of a
+ * client are packed into one I2C_RDWR ioctl of up to I2C_RDWR_IOCTL_MAX_MSGS
+ * messages; those of different clients only if all of them allow it with
+ * I2C::setSharedBatches().
+ *
+ * Devices see a repeated start instead of a stop between packed
+ * transactions. Where the adapter has I2C_FUNC_PROTOCOL_MANGLING, a stop is
+ * forced with I2C_M_STOP. Otherwise a transaction ending with a write ends
+ * the batch, as devices such as EEPROMs act on the stop after a write.
+ *
+ * If a batch fails, all of its transactions complete with the error, or
+ * with ECANCELED if it held transactions of several clients, as the failing
+ * device is not known then. The messages before the failure may have
+ * reached their devices, but nothing is repeated, as writes and destructive
+ * reads (FIFOs, ADC results) are not safe to run twice.
+ * The worker thread is started with the first transaction.
+ */
+class I2CQueue
+{
+	private:
+		friend class I2C;
+
+		struct Request
+		{
+				Request *next;
+				I2C *client;
+				int priority;
+				std::vector<struct i2c_msg> msgs;
+				std::vector<unsigned char> data; //!< Scratch area of the client
+				std::vector<unsigned char *> heapBuffers;
+				bool swapReads;
+				bool shared; //!< May share an ioctl with other clients
+				int len;
+				std::promise<int> promise;
+				std::function<void(int)> callback;
+
+				~Request()
+				{
+					for (unsigned char *buf : heapBuffers)
+						delete[] buf;
+				}
+				;
+		};
+
+		I2CBus *bus;
+		MPSCQueue<Request> queue;
+		std::vector<Request *> pending;
+		std::vector<struct i2c_msg> batch;
+
+		std::thread worker;
+		std::once_flag started;
+		std::mutex lock;
+		std::condition_variable wakeup;
+		bool running;
+
+		I2CQueue(const I2CQueue &) = delete;
+		I2CQueue &operator=(const I2CQueue &) = delete;
+
+		void start();
+		void run();
+
+		/**
+		 * Executes requests reqs[0] .. reqs[num-1] and completes them, all
+		 * with the error if the ioctl fails, or with ECANCELED if they are
+		 * of several clients.
+		 */
+		void execute(Request **reqs, int num);
+
+		/**
+		 * Transfers the messages of requests reqs[0] .. reqs[num-1] in one ioctl.
+		 * @return negative errno on failure
+		 */
+		int transfer(Request **reqs, int num);
+		void complete(Request *req, int result);
+
+		/**
+		 * Queues a request and wakes up the worker if needed.
+		 */
+		void submit(Request *req);
+
+	public:
+		/**
+		 * @param bus Bus the queue belongs to
+		 */
+		I2CQueue(I2CBus *bus);
+		virtual ~I2CQueue();
+};
+
+#endif /* I2CQUEUE_H_ */
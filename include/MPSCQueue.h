@@ -0,0 +1,82 @@
+/*
+ * MPSCQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MPSCQUEUE_H_
+#define MPSCQUEUE_H_
+
+#include <atomic>
+
+/**
+ * @brief Lock-free multiple-producer, single-consumer queue.
+ * The queue is intrusive: elements are linked through their \a next member,
+ * so pushing never allocates. Producers push with a single compare-and-swap.
+ * The consumer takes all queued elements at once and gets them in the order
+ * in which they were pushed.
+ */
+template<typename T>
+class MPSCQueue
+{
+	private:
+		std::atomic<T *> head;
+
+		MPSCQueue(const MPSCQueue &) = delete;
+		MPSCQueue &operator=(const MPSCQueue &) = delete;
+	public:
+		MPSCQueue() :
+				head(nullptr)
+		{
+		}
+		;
+
+		/**
+		 * Adds an element to the queue. Can be called from any thread.
+		 * @param item Element to add. Its \a next member is overwritten.
+		 * @return true if the queue was empty before the call.
+		 */
+		bool push(T *item)
+		{
+			T *old = head.load(std::memory_order_relaxed);
+			do
+			{
+				item->next = old;
+			} while (!head.compare_exchange_weak(old, item,
+					std::memory_order_release, std::memory_order_relaxed));
+			return old == nullptr;
+		}
+		;
+
+		/**
+		 * Removes all elements from the queue. Must be called from one thread only.
+		 * @return List of elements linked through \a next, oldest first, or NULL.
+		 */
+		T *popAll()
+		{
+			T *list = head.exchange(nullptr, std::memory_order_acquire);
+
+			// Elements were pushed on a stack, reverse to get them in FIFO order
+			T *fifo = nullptr;
+			while (list != nullptr)
+			{
+				T *next = list->next;
+				list->next = fifo;
+				fifo = list;
+				list = next;
+			}
+			return fifo;
+		}
+		;
+
+		/**
+		 * @return true if there are no elements in the queue.
+		 */
+		bool empty()
+		{
+			return head.load(std::memory_order_acquire) == nullptr;
+		}
+		;
+};
+
+#endif /* MPSCQUEUE_H_ */
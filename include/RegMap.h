@@ -0,0 +1,275 @@
+/*
+ * RegMap.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef REGMAP_H_
+#define REGMAP_H_
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+
+#include "I2C.h"
+#include "SPI.h"
+
+/**
+ * @brief Cached register map of a device on a serial bus.
+ * Registers are numbered from 0 and hold values of 1, 2 or 4 bytes, sent
+ * most significant byte first. Reads of cached registers do not touch the
+ * bus, and writes that do not change a cached value are dropped. Registers
+ * that the device changes by itself, like status and data registers, are
+ * marked volatile and always go to the bus.
+ *
+ * Writes mark registers dirty. sync() writes all dirty registers, with each
+ * run of consecutive registers as one burst and all bursts in as few bus
+ * transactions as the backend allows. Outside cache-only mode every write
+ * is synced right away.
+ *
+ * Subclasses implement the bus access; the device must auto-increment the
+ * register address within a burst, see setMaxBurst().
+ */
+class RegMap
+{
+	public:
+		/**
+		 * Consecutive registers written as one burst.
+		 */
+		struct Run
+		{
+				unsigned int reg; //!< First register
+				const uint8_t *data; //!< Register values as sent on the bus
+				size_t len; //!< Length of data in bytes
+		};
+
+	private:
+		enum
+		{
+			flagValid = 1, flagDirty = 2, flagVolatile = 4
+		};
+
+		unsigned int numRegs;
+		int valueBytes;
+		unsigned int maxBurst;
+		bool cacheOnly;
+
+		std::vector<uint32_t> cache;
+		std::vector<uint8_t> flags;
+		std::vector<uint8_t> image; //!< Encoded values of dirty registers
+		std::vector<uint8_t> readBuf;
+		std::vector<Run> runs;
+
+		void encode(uint8_t *buf, uint32_t value);
+		uint32_t decode(const uint8_t *buf);
+		bool checkRange(unsigned int reg, unsigned int num);
+		int writeThrough(unsigned int reg, uint32_t value);
+
+	protected:
+		std::recursive_mutex lock;
+
+		/**
+		 * Reads consecutive registers from the device.
+		 * @param reg First register
+		 * @param buf Buffer for the values as sent on the bus
+		 * @param len Number of bytes
+		 * @return negative errno on failure
+		 */
+		virtual int readRaw(unsigned int reg, uint8_t *buf, size_t len) = 0;
+
+		/**
+		 * Writes bursts of registers, in as few transactions as possible.
+		 * @param runs
+		 * @param num
+		 * @return negative errno on failure
+		 */
+		virtual int writeRaw(const Run *runs, int num) = 0;
+
+		/**
+		 * @param numRegs Number of registers
+		 * @param valueBytes Register width in bytes: 1, 2 or 4
+		 */
+		RegMap(unsigned int numRegs, int valueBytes = 1);
+
+	public:
+		virtual ~RegMap();
+
+		/**
+		 * Marks a range of registers volatile, or cacheable again.
+		 * @param first
+		 * @param last Last register of the range, inclusive
+		 * @param isVolatile
+		 * @return negative errno on failure
+		 */
+		int setVolatile(unsigned int first, unsigned int last,
+				bool isVolatile = true);
+
+		/**
+		 * @return true if the register is read from the device every time.
+		 */
+		bool isVolatile(unsigned int reg);
+
+		/**
+		 * Fills the cache with known values, typically the reset values
+		 * from the datasheet, so that updates need no bus read.
+		 * @param reg First register
+		 * @param values
+		 * @param num Number of registers
+		 * @return negative errno on failure
+		 */
+		int setDefaults(unsigned int reg, const uint32_t *values,
+				unsigned int num);
+
+		/**
+		 * Limits the number of registers per burst, for devices that do not
+		 * auto-increment over the whole map. 1 disables bursts.
+		 * @param regs 0 for no limit
+		 */
+		void setMaxBurst(unsigned int regs);
+
+		/**
+		 * In cache-only mode writes only update the cache until sync().
+		 * Leaving the mode syncs.
+		 * @param enable
+		 * @return negative errno on failure
+		 */
+		int setCacheOnly(bool enable);
+
+		/**
+		 * Reads a register, from the cache if possible.
+		 * @param reg
+		 * @param value
+		 * @return negative errno on failure
+		 */
+		int read(unsigned int reg, uint32_t &value);
+
+		/**
+		 * Reads consecutive registers, in one burst if any is not cached.
+		 * @param reg First register
+		 * @param values
+		 * @param num Number of registers
+		 * @return negative errno on failure
+		 */
+		int readBulk(unsigned int reg, uint32_t *values, unsigned int num);
+
+		/**
+		 * Writes a register. Volatile registers are written at once,
+		 * others through the cache.
+		 * @param reg
+		 * @param value
+		 * @return negative errno on failure
+		 */
+		int write(unsigned int reg, uint32_t value);
+
+		/**
+		 * Writes consecutive registers.
+		 * @param reg First register
+		 * @param values
+		 * @param num Number of registers
+		 * @return negative errno on failure
+		 */
+		int writeBulk(unsigned int reg, const uint32_t *values,
+				unsigned int num);
+
+		/**
+		 * Changes some bits of a register. A cached register is not read
+		 * from the device, and is not written if the bits already match.
+		 * @param reg
+		 * @param mask Bits to change
+		 * @param value New value of the bits
+		 * @param changed If not NULL, set to whether the value changed
+		 * @return negative errno on failure
+		 */
+		int updateBits(unsigned int reg, uint32_t mask, uint32_t value,
+				bool *changed = nullptr);
+
+		/**
+		 * Writes all dirty registers to the device.
+		 * @return negative errno on failure
+		 */
+		int sync();
+
+		/**
+		 * Marks all cached registers dirty, e.g. after the device was reset,
+		 * so the next sync() restores them.
+		 */
+		void markDirty();
+
+		/**
+		 * Drops all cached values.
+		 */
+		void invalidate();
+
+		/**
+		 * @return Number of registers.
+		 */
+		unsigned int getNumRegs()
+		{
+			return numRegs;
+		}
+		;
+};
+
+/**
+ * @brief Register map of an I2C device.
+ * The register address is sent before the data. Bursts are written as one
+ * I2C transaction. The handle must use the default MSB_first byte order.
+ */
+class I2CRegMap: public RegMap
+{
+	private:
+		I2C *i2c;
+
+	protected:
+		virtual int readRaw(unsigned int reg, uint8_t *buf, size_t len);
+		virtual int writeRaw(const Run *runs, int num);
+
+	public:
+		/**
+		 * @param i2c Handle of the device, not owned
+		 * @param numRegs Number of registers, at most 256
+		 * @param valueBytes Register width in bytes
+		 */
+		I2CRegMap(I2C *i2c, unsigned int numRegs, int valueBytes = 1);
+		virtual ~I2CRegMap();
+};
+
+/**
+ * @brief Register map of an SPI device.
+ * Each access starts with a byte holding the register address and the
+ * read, write and multi-byte flags of the device, e.g. 0x80 for reads on
+ * most sensors. Bursts are written as one message, with chip select
+ * released between them.
+ */
+class SPIRegMap: public RegMap
+{
+	private:
+		SPI *spi;
+		uint8_t readFlag;
+		uint8_t writeFlag;
+		uint8_t burstFlag;
+
+		std::vector<uint8_t> headers;
+		std::vector<SPI::Segment> segs;
+
+	protected:
+		virtual int readRaw(unsigned int reg, uint8_t *buf, size_t len);
+		virtual int writeRaw(const Run *runs, int num);
+
+	public:
+		/**
+		 * @param spi Channel of the device, not owned
+		 * @param numRegs Number of registers
+		 * @param valueBytes Register width in bytes
+		 * @param readFlag Set in the address byte of reads
+		 * @param writeFlag Set in the address byte of writes
+		 * @param burstFlag Set in the address byte of accesses of more
+		 * 			than one byte
+		 */
+		SPIRegMap(SPI *spi, unsigned int numRegs, int valueBytes = 1,
+				uint8_t readFlag = 0x80, uint8_t writeFlag = 0,
+				uint8_t burstFlag = 0);
+		virtual ~SPIRegMap();
+};
+
+#endif /* REGMAP_H_ */
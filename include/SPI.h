@@ -9,35 +9,193 @@
 #include <linux/spi/spidev.h>
 
 #include <mutex>
-#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <functional>
 
 #include "GPIOpin.h"
 
+class SPITransport;
+
 #ifndef SPI_H_
 #define SPI_H_
 
+/*
+ * Capacity of the table of shared bus resources. Buses and channels with
+ * higher numbers can not be opened.
+ */
+#ifndef SPI_MAX_BUSES
+#define SPI_MAX_BUSES 8
+#endif
+#ifndef SPI_MAX_CHANNELS
+#define SPI_MAX_CHANNELS 4
+#endif
+
+/*
+ * Size of the spidev buffer used when the bufsiz module parameter can not be
+ * read. It is the default of the spidev driver.
+ */
+#ifndef SPIDEV_DEFAULT_BUFSIZ
+#define SPIDEV_DEFAULT_BUFSIZ 4096
+#endif
+
 class SPI
 {
+	public:
+		/**
+		 * Largest number of segments the kernel accepts in one SPI_IOC_MESSAGE ioctl.
+		 * The limit comes from the size field of the ioctl number.
+		 */
+		static const int MaxMessageSegments = ((1 << _IOC_SIZEBITS) - 1)
+				/ sizeof(struct spi_ioc_transfer);
+
+		/**
+		 * Description of one segment of a multi-segment transfer.
+		 * All segments passed to xfer() are sent as one SPI message. Chip select
+		 * stays active between segments unless \a cs_change is set. Messages
+		 * longer than the spidev buffer are split in several ioctls, asking the
+		 * controller to keep chip select active between them.
+		 */
+		struct Segment
+		{
+				const void *wbuf; //!< Data to send. If NULL, zeros are sent.
+				void *rbuf; //!< Buffer for received data. May be NULL.
+				uint32_t len; //!< Length of the segment in bytes.
+				uint32_t speed; //!< Clock speed for this segment. 0 uses the current speed.
+				uint8_t bpw; //!< Bits per word for this segment. 0 uses the current setting.
+				bool cs_change; //!< Deselect the chip after this segment.
+				uint16_t delay_usecs; //!< Delay after the segment, before chip select changes.
+				uint8_t word_delay; //!< Delay between words, in microseconds. Needs kernel 5.x headers, EOPNOTSUPP otherwise.
+				uint8_t tx_nbits; //!< Data lines used to send: 0 or 1 single, 2 dual, 4 quad.
+				uint8_t rx_nbits; //!< Data lines used to receive: 0 or 1 single, 2 dual, 4 quad.
+
+				Segment(const void *wbuf = nullptr, void *rbuf = nullptr,
+						uint32_t len = 0) :
+						wbuf(wbuf), rbuf(rbuf), len(len), speed(0), bpw(0), cs_change(
+								false), delay_usecs(0), word_delay(0), tx_nbits(0), rx_nbits(
+								0)
+				{
+				}
+				;
+		};
+
+		/**
+		 * Set of settings a client uses to talk to its device.
+		 * Clients sharing a channel each keep their own profile. Mode and bit
+		 * order are programmed into the device only when they differ from what
+		 * the channel was last set to; speed and word size are passed with every
+		 * transfer and never need an ioctl.
+		 */
+		struct Profile
+		{
+				uint32_t mode; //!< Clock polarity and phase (SPI_CPOL, SPI_CPHA) and other mode flags
+				uint8_t bpw; //!< Bits per word
+				bool lsb_first; //!< Bit order
+				uint32_t speed; //!< Clock speed in Hz
+
+				Profile(uint32_t mode = 0, uint8_t bpw = 8, bool lsb_first =
+						false, uint32_t speed = 0) :
+						mode(mode), bpw(bpw), lsb_first(lsb_first), speed(speed)
+				{
+				}
+				;
+				bool operator==(const Profile &p) const
+				{
+					return mode == p.mode && bpw == p.bpw
+							&& lsb_first == p.lsb_first && speed == p.speed;
+				}
+				;
+				bool operator!=(const Profile &p) const
+				{
+					return !(*this == p);
+				}
+				;
+		};
+
 	private:
-		uint8_t mode;
-		uint8_t bpw;
-		bool lsb_first;
-		uint32_t speed;
+		friend class SPIQueue;
+
+		Profile profile;
 		int active_bus;
 		int active_channel;
-		int fd;
+		SPITransport *transport;
 
 		struct SharedResources {
 			GPIOpin *volatile cspin = nullptr;
 			volatile int csbit = -1;
 			volatile int cspol = -1;
 			std::recursive_mutex rwlock;
+
+			// Device shared by all clients of the channel
+			SPITransport *transport = nullptr;
+			bool attached = false;
+			int users = 0;
+			// Settings read from the device when it was opened
+			Profile defaults;
+			// Largest number of bytes spidev accepts in one message
+			uint32_t bufsiz = SPIDEV_DEFAULT_BUFSIZ;
+
+			// Device-wide settings last programmed into the device. All clients
+			// of a channel share one spi_device in the kernel.
+			uint32_t mode = 0;
+			bool lsb_first = false;
 		};
 
-		static std::map<int, std::map<int, SharedResources>> share;
 		SharedResources *resources;
-	public:
 
+		// Asynchronous requests submitted and not completed yet, guarded by
+		// pendingLock; idle is signalled when the count drops to zero
+		int pending;
+		std::mutex pendingLock;
+		std::condition_variable idle;
+
+		/**
+		 * Creates an asynchronous request and puts it on the queue of the bus.
+		 */
+		int queueRequest(const Segment *segs, int num, int priority,
+				std::function<void(int)> callback, std::future<int> *result);
+
+		/**
+		 * Returns shared resources of a channel, NULL if out of range.
+		 * The table is fixed-size and built once, so the lookup needs no lock.
+		 */
+		static SharedResources *getResources(int bus, int channel);
+
+		/**
+		 * Opens the transport of a channel, spidev unless another one is
+		 * attached, and reads its settings into \a res.
+		 * Caller must hold the channel lock.
+		 */
+		static int openDevice(int bus, int channel, SharedResources *res);
+		static int closeDevice(SharedResources *res);
+
+		/**
+		 * Programs the device with this client's mode and bit order, skipping
+		 * settings that already match. Caller must hold the lock.
+		 */
+		int applyConfig();
+		int applyConfig(const Profile &profile);
+
+		/**
+		 * Programs the mode word into the device. Caller must hold the lock.
+		 */
+		int writeMode(uint32_t mode);
+
+		/**
+		 * Submits segments without locking or reconfiguring the device.
+		 * Caller must hold the lock.
+		 */
+		int transfer(const Segment *segs, int num);
+
+		/**
+		 * Checks a segment list before it is transferred or queued.
+		 * @return 0, -EINVAL if it is empty or its total length does not
+		 * fit the byte count returned to the caller, or -EOPNOTSUPP if it
+		 * uses a word delay the kernel headers have no field for
+		 */
+		static int checkSegments(const Segment *segs, int num);
+	public:
 		/**
 		 * Default constructor for SPI class.
 		 */
@@ -57,6 +215,26 @@ class SPI
 		 */
 		int close();
 
+		/**
+		 * Function makes a channel use another transport instead of spidev,
+		 * e.g. a device model. Must be called while the channel is not open.
+		 * The transport is not owned and must outlive its use.
+		 * @param bus
+		 * @param channel
+		 * @param transport
+		 * @return negative on failure
+		 */
+		static int attach(int bus, int channel, SPITransport *transport);
+
+		/**
+		 * Function returns a channel to spidev. Must be called while the channel
+		 * is not open.
+		 * @param bus
+		 * @param channel
+		 * @return negative on failure
+		 */
+		static int detach(int bus, int channel);
+
 		/**
 		 * Function selects a chip on the SPI bus.
 		 * Will wait for current operation to finish.
@@ -103,11 +281,27 @@ class SPI
 
 		/**
 		 * Functions sets the idle level and active edge of the clock signal.
+		 * Other mode flags are left unchanged.
 		 * @param mode
 		 * @return
 		 */
 		int setMode(uint8_t mode);
 
+		/**
+		 * Function sets the complete mode word: clock mode together with flags
+		 * like SPI_CS_HIGH, SPI_3WIRE, SPI_TX_DUAL/QUAD and SPI_RX_DUAL/QUAD.
+		 * Transfer widths of segments must be enabled here first.
+		 * Flags above the lowest byte need SPI_IOC_WR_MODE32 (kernel 3.15).
+		 * @param mode
+		 * @return negative on failure
+		 */
+		int setModeFlags(uint32_t mode);
+
+		/**
+		 * @return Complete mode word used by this client.
+		 */
+		uint32_t getModeFlags();
+
 		/**
 		 * Function sets idle level for the clock signal.
 		 * @param pol
@@ -131,6 +325,7 @@ class SPI
 
 		/**
 		 * Function sets the number of bits per transferred word.
+		 * The setting is passed with each transfer, so changing it is free.
 		 * @param bits
 		 * @return
 		 */
@@ -138,11 +333,31 @@ class SPI
 
 		/**
 		 * Function set the speed of the SPI interface.
+		 * The setting is passed with each transfer, so changing it is free.
 		 * @param speed
 		 * @return
 		 */
 		int setSpeed(uint32_t speed);
 
+		/**
+		 * @return Settings currently used by this client.
+		 */
+		Profile getProfile();
+
+		/**
+		 * Function replaces all settings of this client at once. The device is
+		 * reprogrammed lazily by the next transfer, and only if needed.
+		 * @param profile
+		 * @return negative on failure
+		 */
+		int setProfile(const Profile &profile);
+
+		/**
+		 * @return Largest number of bytes the kernel accepts in one SPI message,
+		 * 			0 if no device has been opened. Longer transfers are split
+		 * 			into several messages with chip select kept active.
+		 */
+		uint32_t getMaxMessageSize();
 
 		/**
 		 * Method writes len bytes to the device.
@@ -169,6 +384,107 @@ class SPI
 		 */
 		int xfer1(const void *wbuf, void *rbuf, int len);
 
+		/**
+		 * Function performs a transfer made of several segments with a single
+		 * SPI_IOC_MESSAGE ioctl. Each segment can use its own buffers, speed,
+		 * word size and delays. If there are more than \a MaxMessageSegments
+		 * segments, the transfer is split into several ioctls. Chip select is kept
+		 * active across the split unless the segment before it has \a cs_change set.
+		 * @param segs Array of segments
+		 * @param num Number of segments in the array
+		 * @return Total number of bytes transferred, negative on failure.
+		 */
+		int xfer(const Segment *segs, int num);
+
+		/**
+		 * Function queues a multi-segment transfer for asynchronous execution
+		 * by the worker thread of the bus. Settings of the client at the time of
+		 * submission are used. Segment descriptors are copied, but the data
+		 * buffers must stay valid until the transfer completes.
+		 * GPIO chip select lines are not handled by the worker.
+		 * @param segs Array of segments
+		 * @param num Number of segments in the array
+		 * @param priority Requests with higher priority are executed first
+		 * @return Future receiving the number of bytes transferred or a negative error code
+		 */
+		std::future<int> submit(const Segment *segs, int num, int priority = 0);
+
+		/**
+		 * Function queues a multi-segment transfer for asynchronous execution.
+		 * The callback is called from the worker thread with the number of bytes
+		 * transferred or a negative error code. It must not call flush() or close().
+		 * @param segs Array of segments
+		 * @param num Number of segments in the array
+		 * @param callback Completion callback
+		 * @param priority Requests with higher priority are executed first
+		 * @return negative on failure to queue the request
+		 */
+		int submit(const Segment *segs, int num,
+				std::function<void(int)> callback, int priority = 0);
+
+		/**
+		 * Function waits until all transfers submitted by this client complete.
+		 * Called by close().
+		 */
+		void flush();
+
+		/**
+		 * Scoped exclusive access to the SPI channel.
+		 * The session takes the channel lock once for its whole lifetime, so a
+		 * multi-step exchange with a device can not be interleaved with transfers
+		 * from other threads. On creation the device is reprogrammed with the
+		 * client's settings (only those that differ from what the channel was
+		 * last set to), and optionally a GPIO chip select line is activated.
+		 * The line is released when the session ends.
+		 * Transfer methods of the session do not take the lock again.
+		 */
+		class Session
+		{
+			private:
+				SPI *spi;
+				std::unique_lock<std::recursive_mutex> lock;
+				bool selected;
+				int status;
+
+				Session(const Session &) = delete;
+				Session &operator=(const Session &) = delete;
+			public:
+				/**
+				 * Opens a session without touching chip select lines.
+				 * @param spi Opened SPI device
+				 */
+				Session(SPI &spi);
+
+				/**
+				 * Opens a session and selects a chip with a GPIO line.
+				 * @param spi Opened SPI device
+				 * @param pin GPIO control pin for CS line of chip
+				 * @param bit The control bit within the control pin
+				 * @param polarity Activation logic. Set to 0 or 1 (defaults to 0, ~CS)
+				 */
+				Session(SPI &spi, GPIOpin *pin, int bit = 0, int polarity = 0);
+
+				/**
+				 * Deselects the chip if the session selected it and releases the channel.
+				 */
+				~Session();
+
+				/**
+				 * @return true if the channel has been acquired and configured.
+				 */
+				bool isReady();
+
+				/**
+				 * @return 1 if the session is ready, negative error code otherwise.
+				 */
+				int getStatus();
+
+				int write(const void *wbuf, int len);
+				int read(void *rbuf, int len);
+				int xfer1(const void *wbuf, void *rbuf, int len);
+				int xfer(const Segment *segs, int num);
+		};
+
 		/**
 		 *
 		 */
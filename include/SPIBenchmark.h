@@ -0,0 +1,128 @@
+/*
+ * SPIBenchmark.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPIBENCHMARK_H_
+#define SPIBENCHMARK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <future>
+
+#include "SPI.h"
+#include "SPITransport.h"
+#include "LatencyHistogram.h"
+#include "GPIOpin.h"
+
+/**
+ * @brief Throughput and latency measurement of an SPI channel.
+ * The benchmark takes over a channel: it attaches a counting wrapper around
+ * the spidev device, or around any other transport like a device model, and
+ * runs test cases through regular SPI clients. Each operation moves \a size
+ * bytes and is timed from call to return.
+ */
+class SPIBenchmark
+{
+	public:
+		struct Case
+		{
+				uint32_t size; //!< Bytes per operation
+				uint32_t speed; //!< Clock speed in Hz
+				uint8_t bpw; //!< Bits per word
+				int segments; //!< Number of pieces each operation is split into
+				bool batched; //!< Send the pieces in one message rather than one call each
+				int threads; //!< Clients running the operation concurrently
+				int iterations; //!< Operations per thread
+
+				Case(uint32_t size = 1, uint32_t speed = 1000000, uint8_t bpw = 8,
+						int segments = 1, bool batched = true, int threads = 1,
+						int iterations = 1000) :
+						size(size), speed(speed), bpw(bpw), segments(segments), batched(
+								batched), threads(threads), iterations(iterations)
+				{
+				}
+				;
+		};
+
+		struct Result
+		{
+				Case test;
+				uint64_t operations;
+				uint64_t bytes;
+				uint64_t ioctls; //!< Messages and setup calls reaching the transport
+				int errors;
+				double seconds;
+				double bytesPerSecond;
+				double ioctlsPerSecond;
+				LatencyHistogram latency; //!< Duration of operations in ns
+		};
+
+	private:
+		class CountingTransport;
+
+		int bus;
+		int channel;
+		SPIDevTransport *device;
+		CountingTransport *counter;
+		GPIOpin *cspin;
+		int csbit;
+		int cspol;
+
+		SPIBenchmark(const SPIBenchmark &) = delete;
+		SPIBenchmark &operator=(const SPIBenchmark &) = delete;
+
+		void worker(const Case &test, std::shared_future<void> start,
+				LatencyHistogram *latency, int *errors);
+	public:
+		SPIBenchmark();
+		virtual ~SPIBenchmark();
+
+		/**
+		 * Takes over a channel. The channel must not be open.
+		 * @param bus
+		 * @param channel
+		 * @param backend Transport to measure, NULL for spidev. Not owned.
+		 * @return negative on failure
+		 */
+		int open(int bus, int channel, SPITransport *backend = nullptr);
+
+		/**
+		 * Returns the channel to spidev.
+		 * @return negative on failure
+		 */
+		int close();
+
+		/**
+		 * Drives a GPIO chip select around every operation, to measure its cost.
+		 * @param pin GPIO block, NULL to disable
+		 * @param bit Bit of the chip select line in the block
+		 * @param polarity Active level
+		 */
+		void setChipSelect(GPIOpin *pin, int bit, int polarity = 0);
+
+		/**
+		 * Runs one test case.
+		 * @param test
+		 * @param result
+		 * @return negative on failure
+		 */
+		int run(const Case &test, Result &result);
+
+		/**
+		 * Prints the column names of print().
+		 * @param f
+		 */
+		static void printHeader(FILE *f);
+
+		/**
+		 * Prints one result as a table row.
+		 * @param f
+		 * @param result
+		 */
+		static void print(FILE *f, const Result &result);
+};
+
+#endif /* SPIBENCHMARK_H_ */
@@ -0,0 +1,100 @@
+/*
+ * SPIBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPIBUFFER_H_
+#define SPIBUFFER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Number of free buffers of each size kept for reuse.
+ */
+#ifndef SPI_BUFFER_POOL_DEPTH
+#define SPI_BUFFER_POOL_DEPTH 4
+#endif
+
+/**
+ * @brief Page-aligned transfer buffer drawn from a shared pool.
+ * Buffers are allocated in power-of-two multiples of the page size and
+ * returned to the pool when released, so sending a frame every cycle does
+ * not allocate once the pool is warm. Buffers larger than the biggest pool
+ * size are allocated and freed directly.
+ */
+class SPIBuffer
+{
+	private:
+		uint8_t *buf;
+		size_t len;
+		int sizeClass;
+
+		SPIBuffer(const SPIBuffer &) = delete;
+		SPIBuffer &operator=(const SPIBuffer &) = delete;
+
+		static void *take(int sizeClass, size_t bytes);
+		static void give(void *buf, int sizeClass);
+	public:
+		/**
+		 * Largest buffer kept in the pool, in pages.
+		 */
+		static const size_t MaxPooledPages = 256;
+
+		/**
+		 * Creates an empty buffer.
+		 */
+		SPIBuffer();
+
+		/**
+		 * Creates a buffer of at least len bytes. Check with data() for failure.
+		 * @param len
+		 */
+		explicit SPIBuffer(size_t len);
+
+		SPIBuffer(SPIBuffer &&other);
+		SPIBuffer &operator=(SPIBuffer &&other);
+
+		/**
+		 * Returns the buffer to the pool.
+		 */
+		virtual ~SPIBuffer();
+
+		/**
+		 * Replaces the buffer with one of at least len bytes. Contents are not kept.
+		 * @param len
+		 * @return negative on failure
+		 */
+		int allocate(size_t len);
+
+		/**
+		 * Returns the buffer to the pool.
+		 */
+		void release();
+
+		/**
+		 * @return Start of the buffer, NULL if not allocated.
+		 */
+		uint8_t *data()
+		{
+			return buf;
+		}
+		;
+
+		/**
+		 * @return Size requested at allocation.
+		 */
+		size_t size()
+		{
+			return len;
+		}
+		;
+
+		/**
+		 * Frees all buffers kept in the pool.
+		 */
+		static void trim();
+};
+
+#endif /* SPIBUFFER_H_ */
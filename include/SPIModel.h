@@ -0,0 +1,274 @@
+/*
+ * SPIModel.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPIMODEL_H_
+#define SPIMODEL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+#include "SPITransport.h"
+
+/**
+ * @brief Userspace model of a device on an SPI channel.
+ * A model sees the bus as the device would: chip select edges and the bytes
+ * shifted in both directions. It is attached to a channel through
+ * SPIModelTransport, so drivers can be run and measured without hardware.
+ */
+class SPIDeviceModel
+{
+	public:
+		virtual ~SPIDeviceModel()
+		{
+		}
+		;
+
+		/**
+		 * Called when chip select becomes active.
+		 */
+		virtual void select()
+		{
+		}
+		;
+
+		/**
+		 * Called for the bytes of each transfer while the chip is selected.
+		 * @param tx Data sent by the master, NULL if it sends zeros
+		 * @param rx Buffer for the data the device returns, NULL if discarded
+		 * @param len Number of bytes
+		 */
+		virtual void exchange(const uint8_t *tx, uint8_t *rx, uint32_t len) = 0;
+
+		/**
+		 * Called when chip select becomes inactive.
+		 */
+		virtual void deselect()
+		{
+		}
+		;
+};
+
+/**
+ * @brief Model returning on MISO whatever it receives on MOSI.
+ */
+class SPILoopbackModel: public SPIDeviceModel
+{
+	public:
+		virtual void exchange(const uint8_t *tx, uint8_t *rx, uint32_t len);
+};
+
+/**
+ * @brief Model recording MOSI data and replaying scripted MISO data.
+ * Each selection of the chip is one frame. The bytes received in a frame
+ * are recorded, and the next scripted response is returned from the start
+ * of the frame. Bytes past the end of the response read as the fill value.
+ */
+class SPIScriptedModel: public SPIDeviceModel
+{
+	private:
+		std::deque<std::vector<uint8_t> > responses;
+		std::vector<std::vector<uint8_t> > frames;
+		std::vector<uint8_t> response;
+		size_t position;
+		uint8_t fill;
+	public:
+		SPIScriptedModel(uint8_t fill = 0xFF);
+
+		/**
+		 * Queues the MISO data of one future frame.
+		 * @param data
+		 * @param len
+		 */
+		void addResponse(const void *data, size_t len);
+
+		/**
+		 * @return MOSI data of all frames received so far.
+		 */
+		const std::vector<std::vector<uint8_t> > &getFrames()
+		{
+			return frames;
+		}
+		;
+
+		/**
+		 * Forgets recorded frames and queued responses.
+		 */
+		void clear();
+
+		virtual void select();
+		virtual void exchange(const uint8_t *tx, uint8_t *rx, uint32_t len);
+		virtual void deselect();
+};
+
+/**
+ * @brief Model of a 25-series SPI NOR flash.
+ * Implements JEDEC ID, status, write enable, the read commands, page
+ * program, sector, block and chip erase and 4-byte addressing. The model
+ * sees bytes only, so dual and quad reads behave like Fast Read. Programs
+ * and erases take effect when chip select is released, and the part then
+ * reports busy for a set number of status reads.
+ */
+class SPIFlashModel: public SPIDeviceModel
+{
+	public:
+		struct Stats
+		{
+				uint64_t reads; //!< Read commands
+				uint64_t programs; //!< Page programs
+				uint64_t erases; //!< Sector, block and chip erases
+				uint64_t statusPolls; //!< Status bytes returned
+				uint64_t violations; //!< Commands ignored because the part was busy or not write enabled
+
+				Stats() :
+						reads(0), programs(0), erases(0), statusPolls(0), violations(
+								0)
+				{
+				}
+				;
+		};
+
+	private:
+		std::vector<uint8_t> memory;
+		uint8_t id[3];
+		uint32_t programPolls;
+		uint32_t erasePolls;
+
+		uint32_t busy; //!< Status reads left before the part is idle
+		bool writeEnabled;
+		int addrBytes;
+
+		uint8_t cmd;
+		uint32_t position; //!< Bytes received in this frame
+		uint32_t addr;
+		uint8_t page[256];
+		bool pageUsed[256];
+		Stats stats;
+
+		int headerLength();
+	public:
+		/**
+		 * @param capacity JEDEC capacity code, log2 of the size in bytes
+		 * @param manufacturer JEDEC manufacturer ID
+		 * @param type JEDEC memory type
+		 */
+		SPIFlashModel(uint8_t capacity = 0x16, uint8_t manufacturer = 0xEF,
+				uint8_t type = 0x40);
+
+		/**
+		 * Sets how many status reads programs and erases stay busy for.
+		 * @param program
+		 * @param erase
+		 */
+		void setBusyPolls(uint32_t program, uint32_t erase);
+
+		/**
+		 * @return Contents of the memory array.
+		 */
+		std::vector<uint8_t> &getMemory()
+		{
+			return memory;
+		}
+		;
+
+		Stats getStats()
+		{
+			return stats;
+		}
+		;
+
+		virtual void select();
+		virtual void exchange(const uint8_t *tx, uint8_t *rx, uint32_t len);
+		virtual void deselect();
+};
+
+/**
+ * @brief Transport feeding the messages of a channel to a device model.
+ * Chip select is emulated the way spidev does it, and traffic is counted.
+ * Counters are updated under the channel lock; read them while no transfer
+ * is running.
+ */
+class SPIModelTransport: public SPITransport
+{
+	public:
+		struct Stats
+		{
+				uint64_t messages; //!< Messages, one per ioctl with spidev
+				uint64_t transfers; //!< Transfers within the messages
+				uint64_t bytes; //!< Bytes clocked
+				uint64_t selects; //!< Chip select activations
+				uint64_t setups; //!< Mode and bit order changes
+				uint64_t busTime; //!< Time the transfers take on a real bus, in ns
+
+				Stats() :
+						messages(0), transfers(0), bytes(0), selects(0), setups(0), busTime(
+								0)
+				{
+				}
+				;
+		};
+
+	private:
+		SPIDeviceModel *model;
+		SPI::Profile settings;
+		uint32_t maxMessageSize;
+		bool selected;
+		Stats stats;
+
+		SPIModelTransport(const SPIModelTransport &) = delete;
+		SPIModelTransport &operator=(const SPIModelTransport &) = delete;
+	public:
+		/**
+		 * @param model Device model, not owned
+		 * @param settings Settings the device reports when opened
+		 * @param maxMessageSize Largest message accepted, like spidev bufsiz
+		 */
+		SPIModelTransport(SPIDeviceModel *model, const SPI::Profile &settings =
+				SPI::Profile(0, 8, false, 1000000), uint32_t maxMessageSize =
+		SPIDEV_DEFAULT_BUFSIZ);
+		virtual ~SPIModelTransport();
+
+		/**
+		 * @return Traffic counters.
+		 */
+		Stats getStats()
+		{
+			return stats;
+		}
+		;
+
+		void resetStats()
+		{
+			stats = Stats();
+		}
+		;
+
+		/**
+		 * @return true if chip select is active.
+		 */
+		bool isSelected()
+		{
+			return selected;
+		}
+		;
+
+		/**
+		 * @return Mode word programmed by the master.
+		 */
+		uint32_t getMode()
+		{
+			return settings.mode;
+		}
+		;
+
+		virtual int getSettings(SPI::Profile &settings);
+		virtual int setMode(uint32_t mode);
+		virtual int setLSBFirst(bool lsb_first);
+		virtual int message(struct spi_ioc_transfer *xfers, int num);
+		virtual uint32_t getMaxMessageSize();
+};
+
+#endif /* SPIMODEL_H_ */
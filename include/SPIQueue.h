@@ -0,0 +1,86 @@
+/*
+ * SPIQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPIQUEUE_H_
+#define SPIQUEUE_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <atomic>
+
+#include "SPI.h"
+#include "MPSCQueue.h"
+
+/**
+ * @brief Asynchronous submission queue of one SPI bus.
+ * Requests submitted with SPI::submit() are put on a lock-free queue and
+ * executed by a worker thread owned by the bus. Requests with higher priority
+ * go first, requests with the same priority are executed in submission order.
+ * Consecutive requests from the same client are coalesced into a single
+ * SPI_IOC_MESSAGE ioctl, with chip select released between them just as if
+ * they were submitted one by one.
+ * The worker thread is started with the first request and stopped at exit.
+ */
+class SPIQueue
+{
+	private:
+		friend class SPI;
+
+		struct Request
+		{
+				Request *next;
+				SPI *client;
+				int priority;
+				SPI::Profile profile;
+				std::vector<SPI::Segment> segs;
+				int len;
+				std::promise<int> promise;
+				std::function<void(int)> callback;
+		};
+
+		MPSCQueue<Request> queue;
+		std::vector<Request *> pending;
+		std::vector<SPI::Segment> batch;
+
+		std::thread worker;
+		std::once_flag started;
+		std::mutex lock;
+		std::condition_variable wakeup;
+		bool running;
+
+		SPIQueue(const SPIQueue &) = delete;
+		SPIQueue &operator=(const SPIQueue &) = delete;
+
+		void start();
+		void run();
+
+		/**
+		 * Executes requests reqs[0] .. reqs[num-1] from one client in one message.
+		 */
+		int execute(Request **reqs, int num);
+		void complete(Request *req, int result);
+
+		/**
+		 * Queues a request and wakes up the worker if needed.
+		 */
+		void submit(Request *req);
+
+	public:
+		SPIQueue();
+		virtual ~SPIQueue();
+
+		/**
+		 * Returns the queue of an SPI bus, NULL if the bus is out of range.
+		 * @param bus
+		 */
+		static SPIQueue *getQueue(int bus);
+};
+
+#endif /* SPIQUEUE_H_ */
@@ -0,0 +1,172 @@
+/*
+ * SPIStream.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPISTREAM_H_
+#define SPISTREAM_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SPI.h"
+#include "SPIBuffer.h"
+
+/**
+ * @brief Periodic full-duplex SPI transfers into a ring of blocks.
+ * A real-time thread repeats a prepared message, the template, at a fixed
+ * period. The bytes received by one repetition form a frame; frames are
+ * collected in blocks and the blocks in a single-producer, single-consumer
+ * ring, so the application takes whole blocks without locking. The start
+ * time of every transfer is recorded next to its frame.
+ *
+ * The period is kept with timerfd, or, when a spin margin is set, by
+ * sleeping until shortly before the deadline and spinning the rest of the
+ * way. Frames received while the ring is full are dropped and counted as
+ * overruns; periods the thread could not keep up with are counted as missed.
+ */
+class SPIStream
+{
+	public:
+		struct Block
+		{
+				const uint8_t *data; //!< Frames, one after another
+				const uint64_t *timestamps; //!< Start of each transfer, CLOCK_MONOTONIC ns
+				uint32_t frames; //!< Number of frames in the block
+				uint32_t frameSize; //!< Bytes per frame
+				uint64_t sequence; //!< Number of the block since start
+		};
+
+		struct Stats
+		{
+				uint64_t frames; //!< Transfers done
+				uint64_t overruns; //!< Frames dropped because the ring was full
+				uint64_t missed; //!< Periods skipped because the thread was late
+				uint64_t errors; //!< Failed transfers
+		};
+
+	private:
+		SPI *spi;
+		std::vector<SPI::Segment> segs;
+		uint32_t frameSize;
+
+		uint32_t framesPerBlock;
+		uint32_t numBlocks;
+		SPIBuffer data;
+		std::vector<uint64_t> timestamps;
+		std::vector<Block> blocks;
+		std::vector<uint8_t> scratch;
+
+		// Blocks published by the thread and released by the application
+		std::atomic<uint64_t> head;
+		std::atomic<uint64_t> tail;
+		int event;
+
+		std::atomic<uint64_t> frames;
+		std::atomic<uint64_t> overruns;
+		std::atomic<uint64_t> missed;
+		std::atomic<uint64_t> errors;
+
+		std::thread worker;
+		std::atomic<bool> running;
+		uint64_t period;
+		uint32_t spinMargin;
+		int priority;
+
+		SPIStream(const SPIStream &) = delete;
+		SPIStream &operator=(const SPIStream &) = delete;
+
+		void run();
+
+		/**
+		 * Waits for the next period. Returns the number of periods skipped.
+		 */
+		uint64_t waitPeriod(int timer, uint64_t &deadline);
+	public:
+		/**
+		 * @param spi Opened and configured client, not owned
+		 */
+		SPIStream(SPI *spi);
+		virtual ~SPIStream();
+
+		/**
+		 * Sets the message repeated every period. Segment descriptors are
+		 * copied; data to send must stay valid while the stream runs. Received
+		 * data of all segments forms one frame, the receive buffers of the
+		 * template are not used.
+		 * @param segs
+		 * @param num
+		 * @return negative on failure
+		 */
+		int setTemplate(const SPI::Segment *segs, int num);
+
+		/**
+		 * Sets the size of the ring. Must be called after setTemplate().
+		 * @param framesPerBlock Frames handed to the application at once
+		 * @param blocks Number of blocks in the ring
+		 * @return negative on failure
+		 */
+		int setBuffer(uint32_t framesPerBlock, uint32_t blocks);
+
+		/**
+		 * Makes the thread sleep until this many microseconds before each
+		 * deadline and spin the rest, instead of waiting on a timerfd.
+		 * @param usecs 0 to use timerfd
+		 */
+		void setSpinMargin(uint32_t usecs);
+
+		/**
+		 * Sets SCHED_FIFO priority of the thread. Needs privileges.
+		 * @param priority 0 to leave the default scheduling
+		 */
+		void setPriority(int priority);
+
+		/**
+		 * Starts the thread.
+		 * @param periodNs Period of the transfers in nanoseconds
+		 * @return negative on failure
+		 */
+		int start(uint64_t periodNs);
+
+		/**
+		 * Stops the thread and wakes up the application waiting in
+		 * acquire(). Blocks not released yet stay available.
+		 * @return negative on failure
+		 */
+		int stop();
+
+		bool isRunning()
+		{
+			return running;
+		}
+		;
+
+		/**
+		 * Returns the oldest complete block, which stays valid until release().
+		 * @param timeoutMs Time to wait for a block, -1 to wait forever
+		 * @return Block, or NULL on timeout or if no block is left and the
+		 * 			stream is stopped
+		 */
+		const Block *acquire(int timeoutMs);
+
+		/**
+		 * Gives the block returned by acquire() back to the stream.
+		 */
+		void release();
+
+		/**
+		 * @return Number of complete blocks waiting for the application.
+		 */
+		uint32_t available();
+
+		/**
+		 * @return Counters since start().
+		 */
+		Stats getStats();
+};
+
+#endif /* SPISTREAM_H_ */
@@ -0,0 +1,110 @@
+/*
+ * SPITransport.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPITRANSPORT_H_
+#define SPITRANSPORT_H_
+
+#include <stdint.h>
+#include <linux/spi/spidev.h>
+
+#include "SPI.h"
+
+/**
+ * @brief Backend that carries SPI messages of one channel.
+ * The SPI class prepares complete messages in the spidev format, already
+ * split to fit getMaxMessageSize(), and hands them to the transport of the
+ * channel. The spidev transport is used by default; another one can be
+ * attached to a channel with SPI::attach() before the channel is opened.
+ * Calls are serialized by the channel lock.
+ *
+ * Methods return a negative errno value on failure, which SPI passes on to
+ * its callers, so all transports report errors the same way.
+ */
+class SPITransport
+{
+	public:
+		virtual ~SPITransport()
+		{
+		}
+		;
+
+		/**
+		 * Reads the settings the device currently has.
+		 * @param settings
+		 * @return negative errno on failure
+		 */
+		virtual int getSettings(SPI::Profile &settings) = 0;
+
+		/**
+		 * Programs the complete mode word.
+		 * @param mode
+		 * @return negative errno on failure
+		 */
+		virtual int setMode(uint32_t mode) = 0;
+
+		/**
+		 * Programs the bit order.
+		 * @param lsb_first
+		 * @return negative errno on failure
+		 */
+		virtual int setLSBFirst(bool lsb_first) = 0;
+
+		/**
+		 * Executes one SPI message. Chip select handling follows spidev:
+		 * cs_change deselects the chip after a transfer, or keeps it selected
+		 * after the last transfer of the message.
+		 * @param xfers Transfers of the message
+		 * @param num Number of transfers, at most SPI::MaxMessageSegments
+		 * @return negative errno on failure
+		 */
+		virtual int message(struct spi_ioc_transfer *xfers, int num) = 0;
+
+		/**
+		 * @return Largest number of bytes accepted in one message.
+		 */
+		virtual uint32_t getMaxMessageSize() = 0;
+};
+
+/**
+ * @brief Transport using the spidev kernel driver, /dev/spidevX.Y.
+ */
+class SPIDevTransport: public SPITransport
+{
+	private:
+		int fd;
+
+		SPIDevTransport(const SPIDevTransport &) = delete;
+		SPIDevTransport &operator=(const SPIDevTransport &) = delete;
+	public:
+		SPIDevTransport();
+		virtual ~SPIDevTransport();
+
+		/**
+		 * Opens the spidev device of a bus and channel.
+		 * @param bus
+		 * @param channel
+		 * @return negative errno on failure
+		 */
+		int open(int bus, int channel);
+
+		/**
+		 * Closes the device.
+		 * @return negative errno on failure
+		 */
+		int close();
+
+		virtual int getSettings(SPI::Profile &settings);
+		virtual int setMode(uint32_t mode);
+		virtual int setLSBFirst(bool lsb_first);
+		virtual int message(struct spi_ioc_transfer *xfers, int num);
+
+		/**
+		 * @return Size of the spidev buffer, read from its module parameters.
+		 */
+		virtual uint32_t getMaxMessageSize();
+};
+
+#endif /* SPITRANSPORT_H_ */
@@ -0,0 +1,160 @@
+/*
+ * VirtualGoo.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef VIRTUALGOO_H_
+#define VIRTUALGOO_H_
+
+#include "GPIOoo.h"
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+class VirtualGooP;
+
+/**
+ * @brief GPIO lines of an I/O expander attached to a serial bus.
+ * Keeps a shadow copy of the output latches, directions and input levels of
+ * all lines of the expander. Pin blocks claimed from it change only the
+ * shadow; the expander is updated by flush(), which writes all pending
+ * changes and reads the inputs in as few bus transactions as the device
+ * allows. Depending on the flush mode, flush() is called after every change,
+ * only by the application, or periodically by a background thread.
+ *
+ * Subclasses name the lines and implement update() for their device.
+ */
+class VirtualGoo: public GPIOoo
+{
+	public:
+		enum FlushMode
+		{
+			flushImmediate, //!< Every change is written right away, reads fetch fresh inputs
+			flushExplicit, //!< Changes are written and inputs read by flush() only
+			flushPeriodic //!< A thread flushes at a fixed rate, reads return the last inputs
+		};
+
+		static const int MaxLineNameLen = 16;
+
+	protected:
+		friend class VirtualGooP;
+
+		int numLines;
+		std::vector<uint8_t> outputs; //!< Shadow of the output latches, one bit per line
+		std::vector<uint8_t> directions; //!< Lines with output enabled
+		std::vector<uint8_t> inputs; //!< Input levels read by the last update
+		bool dirty; //!< Shadow has changes not written to the device
+		std::recursive_mutex lock;
+
+		static bool getLine(const std::vector<uint8_t> &bits, int line)
+		{
+			return (bits[line >> 3] >> (line & 7)) & 1;
+		}
+		;
+		static void setLine(std::vector<uint8_t> &bits, int line, bool v)
+		{
+			if (v)
+				bits[line >> 3] |= 1 << (line & 7);
+			else
+				bits[line >> 3] &= ~(1 << (line & 7));
+		}
+		;
+
+		/**
+		 * Returns the index of a named line, -1 if there is no such line.
+		 */
+		virtual int findLine(const char *name) = 0;
+
+		/**
+		 * Returns false for lines whose direction is fixed by the hardware.
+		 */
+		virtual bool canChangeDirection(int)
+		{
+			return true;
+		}
+		;
+
+		/**
+		 * Brings the device in line with the shadow. Called with the lock held.
+		 * @param write Outputs or directions have changed
+		 * @param read Inputs should be read
+		 * @return negative on failure
+		 */
+		virtual int update(bool write, bool read) = 0;
+
+		/**
+		 * Called with the lock held after the shadow has been changed.
+		 */
+		void changed();
+
+		/**
+		 * Stops the flush thread. Subclasses call it from their destructor,
+		 * before the device goes away.
+		 */
+		void stopPeriodic();
+
+		VirtualGoo(int numLines);
+
+	private:
+		std::vector<int> refCounters;
+		std::vector<int> lineFlags;
+
+		FlushMode mode;
+		uint32_t period;
+		std::thread worker;
+		std::atomic<bool> running;
+		std::mutex sleepLock;
+		std::condition_variable sleeper;
+
+		void run();
+	public:
+		virtual ~VirtualGoo();
+
+		using GPIOoo::claim;
+
+		/**
+		 * Claims lines of the expander. Only gpioWrite and gpioWriteAtomic
+		 * are supported: a block is written as a whole under the lock, but
+		 * the device may change its bytes one after another, so neither
+		 * two-step semantics holds.
+		 */
+		virtual GPIOpin *claim(char *names[], int num,
+				gpioWriteSemantics semantics, gpioFlags flags = gpioFlagsNone);
+		virtual void release(GPIOpin **gpio);
+
+		/**
+		 * Selects when changes reach the device.
+		 * @param mode
+		 * @param periodUs Flush period for flushPeriodic, in microseconds
+		 * @return negative on failure
+		 */
+		int setFlushMode(FlushMode mode, uint32_t periodUs = 0);
+
+		FlushMode getFlushMode()
+		{
+			return mode;
+		}
+		;
+
+		/**
+		 * Writes pending changes and reads the inputs.
+		 * @return negative on failure
+		 */
+		int flush();
+
+		/**
+		 * @return Number of lines of the device.
+		 */
+		int getNumLines()
+		{
+			return numLines;
+		}
+		;
+};
+
+#endif /* VIRTUALGOO_H_ */
@@ -0,0 +1,59 @@
+/*
+ * VirtualGooP.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef VIRTUALGOOP_H_
+#define VIRTUALGOOP_H_
+
+#include "GPIOpin.h"
+#include "VirtualGoo.h"
+#include <stdint.h>
+
+/**
+ * @brief Block of lines claimed from a VirtualGoo.
+ * All operations work on the shadow state of the parent and reach the
+ * device according to its flush mode.
+ */
+class VirtualGooP: public GPIOpin
+{
+	public:
+		/**
+		 * Maximum number of pins in a block, limited by the 32-bit values.
+		 */
+		static const int MaxPins = 32;
+
+	private:
+		friend class VirtualGoo;
+
+		VirtualGoo *parent;
+		char localNames[MaxPins][VirtualGoo::MaxLineNameLen + 1];
+		int lines[MaxPins];
+		int num;
+		int current;
+
+		int addLine(int line, const char *name);
+		VirtualGooP(int num, VirtualGoo *parent);
+		virtual ~VirtualGooP();
+	public:
+
+		virtual void namePin(int i, char *name);
+		virtual void namePins(char *names[]);
+		virtual int findPinIndex(char *name);
+
+		virtual void enableOutput(bool enable);
+		virtual void enableOutput(int i, bool enable);
+		virtual void enableOutput(int *outs, int num);
+		virtual void enableOutput(char **outNames, int num);
+		virtual void write(uint32_t v);
+		virtual void set(uint32_t v);
+		virtual void setBit(int bit);
+		virtual void clear(uint32_t v);
+		virtual void clearBit(int bit);
+		virtual uint32_t read();
+		virtual void saveState(State &state);
+		virtual void restoreState(const State &state);
+};
+
+#endif /* VIRTUALGOOP_H_ */
@@ -41,14 +41,61 @@ class BeagleGoo: public GPIOoo
 		static const int MaxGpioNameLen = 32;
 		static const int GpioMemBlockLength = 0xfff;
 
+		//GPIO module register offsets
+		static const int DataOutReg = 0x13C;
+		static const int DataInReg = 0x138;
+		static const int GpioOeReg = 0x134;
+		//spru73h pg 4093
+		static const int DataClearReg = 0x190;
+		//spru73h pg 4094
+		static const int DataSetReg = 0x194;
+
 		BeagleGoo();
 	public:
+		/**
+		 * Snapshot of direction and output state of all claimed GPIO lines.
+		 * Each array holds one word per GPIO bank.
+		 */
+		struct Snapshot
+		{
+				uint32_t mask[4]; //!< Lines covered by the snapshot (claimed when it was taken)
+				uint32_t oe[4]; //!< OE register bits of the covered lines (1 = input)
+				uint32_t dataOut[4]; //!< DATA_OUT register bits of the covered lines
+
+				bool operator==(const Snapshot &s) const
+				{
+					for (int i = 0; i < 4; i++)
+						if (mask[i] != s.mask[i] || oe[i] != s.oe[i]
+								|| dataOut[i] != s.dataOut[i])
+							return false;
+					return true;
+				}
+				;
+				bool operator!=(const Snapshot &s) const
+				{
+					return !(*this == s);
+				}
+				;
+		};
 
 		virtual ~BeagleGoo();
 
 		virtual GPIOpin *claim(char *names[], int num,
 				gpioWriteSemantics semantics, gpioFlags flags = gpioFlagsNone);
 		virtual void release(GPIOpin **gpio);
+
+		/**
+		 * Captures direction and output values of all currently claimed lines.
+		 * @param snapshot
+		 */
+		void snapshot(Snapshot &snapshot);
+
+		/**
+		 * Restores lines captured by snapshot() with one DATA_OUT and one OE store
+		 * per bank. Lines not covered by the snapshot are left untouched.
+		 * @param snapshot
+		 */
+		void restore(const Snapshot &snapshot);
 };
 
 #endif /* BEAGLEGOO_H_ */
@@ -12,16 +12,37 @@
 #include "BeagleGoo.h"
 #include <stdint.h>
 
+/**
+ * Number of pin blocks that can be claimed at the same time. Blocks are
+ * constructed in a statically allocated pool, so the limit is fixed at
+ * compile time.
+ */
+#ifndef BEAGLEGOO_MAX_BLOCKS
+#define BEAGLEGOO_MAX_BLOCKS 16
+#endif
+
 class BeagleGooP: public GPIOpin
 {
+	public:
+		/**
+		 * Maximum number of pins in a block. Values written to and read from the block
+		 * are 32-bit words, so larger blocks could not be addressed anyway.
+		 */
+		static const int MaxPins = 32;
+
+		/**
+		 * Maximum number of blocks claimed at the same time.
+		 */
+		static const int MaxBlocks = BEAGLEGOO_MAX_BLOCKS;
+
 	private:
 		friend class BeagleGoo;
 
 		BeagleGoo *parent;
-		char **localNames;
-		BeagleGoo::GPIOInfo **pins;
-		uint32_t *ports;
-		uint32_t *masks;
+		char localNames[MaxPins][BeagleGoo::MaxGpioNameLen + 1];
+		BeagleGoo::GPIOInfo *pins[MaxPins];
+		uint32_t ports[MaxPins];
+		uint32_t masks[MaxPins];
 		int num;
 		int current;
 		GPIOoo::gpioWriteSemantics writeSemantics;
@@ -29,6 +50,13 @@ class BeagleGooP: public GPIOpin
 		BeagleGooP(int num, BeagleGoo::gpioWriteSemantics semantics,
 				BeagleGoo *parent);
 		virtual ~BeagleGooP();
+
+		/**
+		 * Blocks are allocated from a fixed pool instead of the heap.
+		 * Returns NULL if all slots are in use.
+		 */
+		static void *operator new(size_t size) noexcept;
+		static void operator delete(void *p);
 	public:
 
 		virtual void namePin(int i, char *name);
@@ -45,6 +73,8 @@ class BeagleGooP: public GPIOpin
 		virtual void clear(uint32_t v);
 		virtual void clearBit(int bit);
 		virtual uint32_t read();
+		virtual void saveState(State &state);
+		virtual void restoreState(const State &state);
 };
 
 #endif /* BEAGLEGOOP_H_ */
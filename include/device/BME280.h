@@ -0,0 +1,222 @@
+/*
+ * BME280.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef BME280_H_
+#define BME280_H_
+
+#include <stdint.h>
+
+#include "../I2C.h"
+
+/**
+ * @brief Bosch BME280 humidity/pressure/temperature sensor, or BMP280
+ * pressure/temperature sensor, on I2C.
+ * The calibration coefficients are read once by init(). A sample is read
+ * with one burst over all data registers and compensated with the integer
+ * formulas of the datasheet, without floating point.
+ *
+ * In forced mode, measure() starts a conversion and reads the result after
+ * the worst case measurement time. In normal mode the sensor measures on
+ * its own; readNext() sleeps until the next standby period has passed, so
+ * each sample is read once.
+ *
+ * The I2C handle must use the default MSB_first byte order.
+ */
+class BME280
+{
+	public:
+		static const uint8_t ChipIdBME280 = 0x60;
+		static const uint8_t ChipIdBMP280 = 0x58;
+
+		// Registers
+		static const uint8_t RegCalib00 = 0x88;
+		static const uint8_t RegChipId = 0xD0;
+		static const uint8_t RegReset = 0xE0;
+		static const uint8_t RegCalib26 = 0xE1;
+		static const uint8_t RegCtrlHum = 0xF2;
+		static const uint8_t RegStatus = 0xF3;
+		static const uint8_t RegCtrlMeas = 0xF4;
+		static const uint8_t RegConfig = 0xF5;
+		static const uint8_t RegData = 0xF7;
+
+		enum Mode
+		{
+			modeSleep = 0, modeForced = 1, modeNormal = 3
+		};
+
+		/**
+		 * Oversampling of a measurement; skipped measurements read as 0.
+		 */
+		enum Oversampling
+		{
+			osSkip = 0, os1 = 1, os2 = 2, os4 = 3, os8 = 4, os16 = 5
+		};
+
+		enum Filter
+		{
+			filterOff = 0, filter2 = 1, filter4 = 2, filter8 = 3, filter16 = 4
+		};
+
+		/**
+		 * Standby time between measurements in normal mode. The last two
+		 * are 10 and 20 ms on the BME280, 2 and 4 s on the BMP280.
+		 */
+		enum Standby
+		{
+			standby0_5ms = 0,
+			standby62_5ms = 1,
+			standby125ms = 2,
+			standby250ms = 3,
+			standby500ms = 4,
+			standby1000ms = 5,
+			standby10ms = 6,
+			standby20ms = 7
+		};
+
+		/**
+		 * Compensated measurements in fixed point.
+		 */
+		struct Sample
+		{
+				int32_t temperature; //!< Temperature in 0.01 degC
+				uint32_t pressure; //!< Pressure in Pa, Q24.8 (Pa * 256)
+				uint32_t humidity; //!< Relative humidity in %, Q22.10 (% * 1024)
+		};
+
+	private:
+		I2C *i2c;
+		uint8_t chipId;
+
+		// Calibration coefficients
+		uint16_t T1;
+		int16_t T2, T3;
+		uint16_t P1;
+		int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+		uint8_t H1, H3;
+		int16_t H2, H4, H5;
+		int8_t H6;
+
+		Mode mode;
+		uint8_t ctrlMeas;
+		uint32_t measureTime; //!< Worst case measurement time in us
+		uint32_t period; //!< Normal mode cycle in us
+		uint64_t nextRead; //!< Monotonic time of the next normal mode read, in ns
+
+		uint8_t data[8];
+
+		/*
+		 * Writes register/value pairs in one message; the sensor does not
+		 * auto-increment on writes
+		 */
+		int writePairs(const uint8_t *pairs, int num);
+		int32_t compensateT(int32_t adc, int32_t &tFine);
+		uint32_t compensateP(int32_t adc, int32_t tFine);
+		uint32_t compensateH(int32_t adc, int32_t tFine);
+
+	public:
+		/**
+		 * @param i2c Client with the sensor's address set (0x76 or 0x77),
+		 * 			not owned
+		 */
+		BME280(I2C *i2c);
+		virtual ~BME280();
+
+		/**
+		 * Resets the sensor, checks its chip ID and reads the calibration
+		 * coefficients. The sensor is left in sleep mode.
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is ENODEV for an unknown chip.
+		 */
+		int init();
+
+		/**
+		 * @return true for a BME280, false for a BMP280 without humidity.
+		 */
+		bool hasHumidity()
+		{
+			return chipId == ChipIdBME280;
+		}
+		;
+
+		/**
+		 * Sets oversampling, filter and mode. Normal mode starts
+		 * measuring at once.
+		 *
+		 * @param mode
+		 * @param temperature Temperature oversampling
+		 * @param pressure Pressure oversampling
+		 * @param humidity Humidity oversampling, ignored on the BMP280
+		 * @param filter IIR filter coefficient
+		 * @param standby Standby time in normal mode
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int configure(Mode mode, Oversampling temperature = os1,
+				Oversampling pressure = os1, Oversampling humidity = os1,
+				Filter filter = filterOff, Standby standby = standby0_5ms);
+
+		/**
+		 * @return Worst case measurement time in microseconds.
+		 */
+		uint32_t getMeasurementTime()
+		{
+			return measureTime;
+		}
+		;
+
+		/**
+		 * @return Time between samples in normal mode, in microseconds.
+		 */
+		uint32_t getPeriod()
+		{
+			return period;
+		}
+		;
+
+		/**
+		 * Starts a measurement in forced mode.
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int trigger();
+
+		/**
+		 * Reads and compensates the last measurement, in one burst.
+		 *
+		 * @param sample
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int read(Sample &sample);
+
+		/**
+		 * Takes a sample in forced mode: triggers a measurement, sleeps for
+		 * the measurement time and reads the result.
+		 *
+		 * @param sample
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int measure(Sample &sample);
+
+		/**
+		 * Reads the next sample. In normal mode, sleeps until a period has
+		 * passed since the last read; in forced mode, same as measure().
+		 *
+		 * @param sample
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int readNext(Sample &sample);
+};
+
+#endif /* BME280_H_ */
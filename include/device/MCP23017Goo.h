@@ -0,0 +1,81 @@
+/*
+ * MCP23017Goo.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MCP23017GOO_H_
+#define MCP23017GOO_H_
+
+#include "VirtualGoo.h"
+#include "I2C.h"
+#include "GPIOpin.h"
+
+/**
+ * @brief GPIO lines of an MCP23017 I2C port expander.
+ * Lines are named "GPA0".."GPA7" and "GPB0".."GPB7". The IODIR, OLAT and
+ * GPPU registers are cached, and a flush writes only the registers that
+ * changed, together with the read of the GPIO registers, in one I2C
+ * transaction.
+ *
+ * If the INTA line of the chip is connected to a GPIO input, interrupt on
+ * change is enabled on all pins (INTA and INTB mirrored) and the inputs are
+ * read from the bus only when the line is active, or after a write.
+ */
+class MCP23017Goo: public VirtualGoo
+{
+	public:
+		// Register addresses with IOCON.BANK = 0. A and B registers are adjacent.
+		static const uint8_t RegIODIR = 0x00;
+		static const uint8_t RegIPOL = 0x02;
+		static const uint8_t RegGPINTEN = 0x04;
+		static const uint8_t RegDEFVAL = 0x06;
+		static const uint8_t RegINTCON = 0x08;
+		static const uint8_t RegIOCON = 0x0A;
+		static const uint8_t RegGPPU = 0x0C;
+		static const uint8_t RegINTF = 0x0E;
+		static const uint8_t RegINTCAP = 0x10;
+		static const uint8_t RegGPIO = 0x12;
+		static const uint8_t RegOLAT = 0x14;
+
+	private:
+		I2C *i2c;
+		GPIOpin *intPin;
+		int intBit;
+
+		// Register contents last written to the chip, A in the low byte
+		uint16_t iodir;
+		uint16_t olat;
+		uint16_t gppu;
+		uint16_t pullups; //!< Pull-ups requested by setPullup()
+		bool synced; //!< Cached registers match the chip
+		bool stale; //!< Inputs must be read regardless of the interrupt line
+
+		uint8_t wbuf[4][3];
+		uint8_t rbuf[2];
+
+	protected:
+		virtual int findLine(const char *name);
+		virtual int update(bool write, bool read);
+
+	public:
+		/**
+		 * Configures the chip and reads the inputs.
+		 * @param i2c Client with the chip's address set, not owned
+		 * @param intPin Block with the line connected to INTA, or NULL to read
+		 * 			the inputs on every flush
+		 * @param intBit Bit of the interrupt line in the block
+		 */
+		MCP23017Goo(I2C *i2c, GPIOpin *intPin = nullptr, int intBit = 0);
+		virtual ~MCP23017Goo();
+
+		/**
+		 * Enables or disables the internal 100k pull-up of a line.
+		 * @param name Line name
+		 * @param enable
+		 * @return negative on failure
+		 */
+		int setPullup(const char *name, bool enable);
+};
+
+#endif /* MCP23017GOO_H_ */
@@ -0,0 +1,220 @@
+/*
+ * MPU6050.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MPU6050_H_
+#define MPU6050_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "../I2C.h"
+#include "../GPIOpin.h"
+
+/**
+ * @brief InvenSense MPU-6050 accelerometer and gyroscope, and register
+ * compatible parts (MPU-6500, MPU-9250, ICM-20602), read through the
+ * on-chip FIFO.
+ *
+ * The chip writes one frame per sample to the FIFO: accelerometer X, Y, Z,
+ * temperature and gyroscope X, Y, Z, each big-endian 16-bit, for the
+ * enabled channels. drain() reads all complete frames in one I2C
+ * transaction, together with the FIFO count and interrupt status for the
+ * next call. When samples arrived during the read, as when draining
+ * continuously, the next drain is a single ioctl. Frames are byte-swapped
+ * as one block and unpacked into one array per channel.
+ *
+ * If the FIFO overflows, frames are overwritten and the frame boundaries
+ * are lost. drain() then discards the data, resets the FIFO and fails with
+ * EOVERFLOW; the overflows are counted.
+ *
+ * The I2C handle must use the default MSB_first byte order.
+ */
+class MPU6050
+{
+	public:
+		static const uint8_t WhoAmIMPU6050 = 0x68;
+		static const uint8_t WhoAmIMPU6500 = 0x70;
+		static const uint8_t WhoAmIMPU9250 = 0x71;
+		static const uint8_t WhoAmIICM20602 = 0x12;
+
+		// Registers
+		static const uint8_t RegSmplrtDiv = 0x19;
+		static const uint8_t RegConfig = 0x1A;
+		static const uint8_t RegGyroConfig = 0x1B;
+		static const uint8_t RegAccelConfig = 0x1C;
+		static const uint8_t RegFifoEn = 0x23;
+		static const uint8_t RegIntPinCfg = 0x37;
+		static const uint8_t RegIntEnable = 0x38;
+		static const uint8_t RegIntStatus = 0x3A;
+		static const uint8_t RegAccelXoutH = 0x3B;
+		static const uint8_t RegUserCtrl = 0x6A;
+		static const uint8_t RegPwrMgmt1 = 0x6B;
+		static const uint8_t RegFifoCountH = 0x72;
+		static const uint8_t RegFifoRW = 0x74;
+		static const uint8_t RegWhoAmI = 0x75;
+
+		/**
+		 * Channels written to the FIFO, may be combined.
+		 */
+		enum Channels
+		{
+			fifoAccel = 0x08, fifoTemp = 0x80, fifoGyro = 0x70
+		};
+
+		enum AccelRange
+		{
+			accel2g = 0, accel4g = 1, accel8g = 2, accel16g = 3
+		};
+
+		enum GyroRange
+		{
+			gyro250dps = 0, gyro500dps = 1, gyro1000dps = 2, gyro2000dps = 3
+		};
+
+		/**
+		 * Bandwidth of the digital low pass filter. With dlpf260Hz the
+		 * gyroscope runs at 8 kHz, otherwise at 1 kHz.
+		 */
+		enum Dlpf
+		{
+			dlpf260Hz = 0,
+			dlpf188Hz = 1,
+			dlpf98Hz = 2,
+			dlpf42Hz = 3,
+			dlpf20Hz = 4,
+			dlpf10Hz = 5,
+			dlpf5Hz = 6
+		};
+
+		/**
+		 * Samples unpacked by drain(), one array per channel. Arrays of
+		 * channels that are not in the FIFO are left empty.
+		 */
+		struct Samples
+		{
+				std::vector<int16_t> accel[3]; //!< X, Y, Z
+				std::vector<int16_t> temperature;
+				std::vector<int16_t> gyro[3]; //!< X, Y, Z
+				size_t count; //!< Number of valid samples in each array
+
+				Samples() :
+						count(0)
+				{
+				}
+				;
+		};
+
+	private:
+		I2C *i2c;
+		GPIOpin *intPin;
+		int intBit;
+
+		uint8_t whoAmI;
+		size_t fifoSize;
+		int channels;
+		int frameSize; //!< Bytes per FIFO frame
+		uint32_t rate; //!< Sample rate in Hz
+
+		std::vector<uint16_t> raw; //!< FIFO data, word aligned
+		uint8_t countBuf[2];
+		uint8_t status;
+		size_t fifoCount;
+		bool countValid; //!< fifoCount and status are from the last drain
+
+		uint64_t overflows;
+
+		int resetFifo();
+		int readState();
+		void unpack(Samples &samples, size_t frames);
+
+	public:
+		/**
+		 * @param i2c Client with the chip's address set (0x68 or 0x69),
+		 * 			not owned
+		 * @param intPin Block with the line connected to INT, or NULL
+		 * @param intBit Bit of the interrupt line in the block
+		 */
+		MPU6050(I2C *i2c, GPIOpin *intPin = nullptr, int intBit = 0);
+		virtual ~MPU6050();
+
+		/**
+		 * Checks the chip ID, resets the chip and wakes it up with the
+		 * gyroscope PLL as clock.
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is ENODEV for an unknown chip.
+		 */
+		int init();
+
+		/**
+		 * Sets the sample rate and ranges, and starts writing samples to the
+		 * FIFO. The FIFO is reset. If an interrupt line is given, the data
+		 * ready and FIFO overflow interrupts are enabled, latched until the
+		 * interrupt status is read.
+		 *
+		 * @param rate Sample rate in Hz, divided down from the gyroscope rate
+		 * @param accel Accelerometer range
+		 * @param gyro Gyroscope range
+		 * @param dlpf Low pass filter
+		 * @param channels Channels written to the FIFO, see #Channels
+		 *
+		 * @return 0 on success or -1 on error.
+		 * 			errno is updated.
+		 */
+		int configure(uint32_t rate, AccelRange accel = accel2g,
+				GyroRange gyro = gyro250dps, Dlpf dlpf = dlpf188Hz,
+				int channels = fifoAccel | fifoGyro);
+
+		/**
+		 * @return Sample rate in Hz after division
+		 */
+		uint32_t getRate()
+		{
+			return rate;
+		}
+		;
+
+		/**
+		 * @return Size of the FIFO in bytes
+		 */
+		size_t getFifoSize()
+		{
+			return fifoSize;
+		}
+		;
+
+		/**
+		 * @return Number of FIFO overflows
+		 */
+		uint64_t getOverflows()
+		{
+			return overflows;
+		}
+		;
+
+		/**
+		 * Waits for new data. With an interrupt line, polls the line until
+		 * it is active; without, sleeps one sample period.
+		 *
+		 * @param timeout Maximum time to wait in microseconds
+		 *
+		 * @return 1 if data is ready, 0 on timeout.
+		 */
+		int wait(uint32_t timeout);
+
+		/**
+		 * Reads all complete frames from the FIFO and unpacks them.
+		 *
+		 * @param samples Arrays to unpack into; they are sized for a full
+		 * 			FIFO on first use.
+		 *
+		 * @return Number of samples read, or -1 on error.
+		 * 			errno is EOVERFLOW if the FIFO overflowed.
+		 */
+		int drain(Samples &samples);
+};
+
+#endif /* MPU6050_H_ */
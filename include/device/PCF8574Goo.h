@@ -0,0 +1,55 @@
+/*
+ * PCF8574Goo.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef PCF8574GOO_H_
+#define PCF8574GOO_H_
+
+#include "VirtualGoo.h"
+#include "I2C.h"
+#include "GPIOpin.h"
+
+/**
+ * @brief GPIO lines of a PCF8574 or PCF8575 I2C port expander.
+ * Lines are named "P0".."P7", or "P0".."P15" for the 16-bit PCF8575. The
+ * chip has quasi-bidirectional pins without registers: a line is an input
+ * while it is written as 1. A flush writes the port and reads it back in
+ * one I2C transaction.
+ *
+ * If the INT line of the chip is connected to a GPIO input, the port is
+ * read from the bus only when the line is active, or after a write.
+ */
+class PCF8574Goo: public VirtualGoo
+{
+	private:
+		I2C *i2c;
+		GPIOpin *intPin;
+		int intBit;
+		int bytes;
+		uint16_t port; //!< Value last written to the port
+		bool synced;
+		bool stale; //!< Port must be read regardless of the interrupt line
+
+		uint8_t wbuf[2];
+		uint8_t rbuf[2];
+
+	protected:
+		virtual int findLine(const char *name);
+		virtual int update(bool write, bool read);
+
+	public:
+		/**
+		 * Sets all lines to inputs and reads them.
+		 * @param i2c Client with the chip's address set, not owned
+		 * @param lines 8 for PCF8574, 16 for PCF8575
+		 * @param intPin Block with the line connected to INT, or NULL
+		 * @param intBit Bit of the interrupt line in the block
+		 */
+		PCF8574Goo(I2C *i2c, int lines = 8, GPIOpin *intPin = nullptr,
+				int intBit = 0);
+		virtual ~PCF8574Goo();
+};
+
+#endif /* PCF8574GOO_H_ */
@@ -0,0 +1,217 @@
+/*
+ * SPIFlash.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPIFLASH_H_
+#define SPIFLASH_H_
+
+#include <stdint.h>
+#include <list>
+#include <vector>
+
+#include "../SPI.h"
+
+// Worst case operation times of common 25-series parts, in microseconds
+#ifndef SPIFLASH_PROGRAM_TIMEOUT
+#define SPIFLASH_PROGRAM_TIMEOUT	5000
+#endif
+#ifndef SPIFLASH_SECTOR_TIMEOUT
+#define SPIFLASH_SECTOR_TIMEOUT		500000
+#endif
+#ifndef SPIFLASH_BLOCK_TIMEOUT
+#define SPIFLASH_BLOCK_TIMEOUT		3000000
+#endif
+#ifndef SPIFLASH_CHIP_TIMEOUT
+#define SPIFLASH_CHIP_TIMEOUT		400000000
+#endif
+
+/**
+ * @brief 25-series SPI NOR flash.
+ * The part is identified by its JEDEC ID, which also gives its size. Reads
+ * use Fast Read, or Dual/Quad Output Fast Read if the channel has the
+ * SPI_RX_DUAL or SPI_RX_QUAD mode flag, and are split into messages as
+ * large as the channel accepts. Programming is split on page boundaries;
+ * the write enable, the page program and the first status poll go out in a
+ * single message, and the busy bit is then polled without sleeping.
+ *
+ * Parts larger than 16 MiB are switched to 4-byte addressing.
+ * Quad reads need the part's QE bit set, which is vendor specific and left
+ * to the application.
+ */
+class SPIFlash
+{
+	public:
+		static const uint32_t PageSize = 256;
+		static const uint32_t SectorSize = 4096;
+		static const uint32_t BlockSize = 65536;
+
+		// Commands
+		static const uint8_t CmdWriteEnable = 0x06;
+		static const uint8_t CmdWriteDisable = 0x04;
+		static const uint8_t CmdReadStatus = 0x05;
+		static const uint8_t CmdRead = 0x03;
+		static const uint8_t CmdFastRead = 0x0B;
+		static const uint8_t CmdDualRead = 0x3B;
+		static const uint8_t CmdQuadRead = 0x6B;
+		static const uint8_t CmdPageProgram = 0x02;
+		static const uint8_t CmdSectorErase = 0x20;
+		static const uint8_t CmdBlockErase = 0xD8;
+		static const uint8_t CmdChipErase = 0xC7;
+		static const uint8_t CmdJedecId = 0x9F;
+		static const uint8_t CmdEnter4Byte = 0xB7;
+		static const uint8_t CmdReleasePowerDown = 0xAB;
+
+		// Status register bits
+		static const uint8_t StatusBusy = 0x01;
+		static const uint8_t StatusWriteEnabled = 0x02;
+
+		enum ReadMode
+		{
+			readNormal, //!< Read (0x03), for slow clocks
+			readFast, //!< Fast Read (0x0B)
+			readDual, //!< Dual Output Fast Read (0x3B)
+			readQuad //!< Quad Output Fast Read (0x6B)
+		};
+
+	private:
+		struct Mapping
+		{
+				uint32_t addr;
+				std::vector<uint8_t> data;
+
+				Mapping(uint32_t addr, uint32_t len) :
+						addr(addr), data(len)
+				{
+				}
+				;
+		};
+
+		SPI *spi;
+		uint8_t id[3];
+		uint32_t size;
+		int addrBytes;
+		ReadMode readMode;
+		std::list<Mapping> mappings;
+
+		int header(uint8_t *buf, uint8_t cmd, uint32_t addr);
+		int modify(const uint8_t *hdr, int hlen, const void *data,
+				uint32_t len, uint32_t timeout);
+		int readStatus(uint8_t &status);
+		void mirror(uint32_t addr, const uint8_t *data, uint32_t len);
+
+	public:
+		/**
+		 * @param spi Open channel of the part, not owned
+		 */
+		SPIFlash(SPI *spi);
+		virtual ~SPIFlash();
+
+		/**
+		 * Wakes the part, reads its JEDEC ID and picks the fastest read
+		 * mode the channel supports.
+		 * @return 1 on success, -ENODEV if no part answers, negative on failure
+		 */
+		int probe();
+
+		/**
+		 * @return Manufacturer ID byte.
+		 */
+		uint8_t getManufacturer()
+		{
+			return id[0];
+		}
+		;
+
+		/**
+		 * @return Memory type and capacity bytes.
+		 */
+		uint16_t getDeviceId()
+		{
+			return (id[1] << 8) | id[2];
+		}
+		;
+
+		/**
+		 * @return Size in bytes, 0 before a successful probe().
+		 */
+		uint32_t getSize()
+		{
+			return size;
+		}
+		;
+
+		/**
+		 * Selects the read command.
+		 * @param mode
+		 * @return negative on failure, -EINVAL if the channel does not have
+		 * 			the needed data lines
+		 */
+		int setReadMode(ReadMode mode);
+
+		ReadMode getReadMode()
+		{
+			return readMode;
+		}
+		;
+
+		/**
+		 * Reads any range of the memory.
+		 * @param addr
+		 * @param buf
+		 * @param len
+		 * @return Number of bytes read, negative on failure
+		 */
+		int read(uint32_t addr, void *buf, uint32_t len);
+
+		/**
+		 * Programs any range of the memory. Programming only clears bits;
+		 * the range must have been erased.
+		 * @param addr
+		 * @param buf
+		 * @param len
+		 * @return Number of bytes written, negative on failure
+		 */
+		int write(uint32_t addr, const void *buf, uint32_t len);
+
+		/**
+		 * Erases a range aligned to sectors, with 64 KiB block erases where
+		 * the range covers whole blocks and sector erases elsewhere.
+		 * @param addr
+		 * @param len
+		 * @return negative on failure, -EINVAL if the range is not aligned
+		 */
+		int erase(uint32_t addr, uint32_t len);
+
+		/**
+		 * Erases the whole part.
+		 * @return negative on failure
+		 */
+		int eraseChip();
+
+		/**
+		 * Polls the busy bit until the part is idle.
+		 * @param timeoutUs
+		 * @return negative on failure, -ETIMEDOUT if still busy
+		 */
+		int waitReady(uint32_t timeoutUs);
+
+		/**
+		 * Returns a cached copy of a range of the memory. The copy is read
+		 * once and kept coherent with writes and erases made through this
+		 * object until it is unmapped.
+		 * @param addr
+		 * @param len
+		 * @return Pointer to the copy, NULL on failure
+		 */
+		const uint8_t *map(uint32_t addr, uint32_t len);
+
+		/**
+		 * Drops a copy returned by map().
+		 * @param view
+		 */
+		void unmap(const uint8_t *view);
+};
+
+#endif /* SPIFLASH_H_ */
@@ -0,0 +1,74 @@
+/*
+ * ShiftRegisterGoo.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SHIFTREGISTERGOO_H_
+#define SHIFTREGISTERGOO_H_
+
+#include "VirtualGoo.h"
+#include "SPI.h"
+#include "GPIOpin.h"
+
+#include <vector>
+
+/**
+ * @brief GPIO lines on chains of 74HC595 and 74HC165 shift registers.
+ * Output registers are chained on MOSI, input registers on MISO, sharing
+ * the clock, so one full-duplex SPI transfer writes all outputs and reads
+ * all inputs. Lines are named "OUT0".."OUTn" and "IN0".."INm"; OUT0 is Q0
+ * of the register next to the host, IN0 is input A of the 74HC165 next to
+ * the host. The SPI client must be set to MSB first.
+ *
+ * Outputs are latched on the rising edge of the \a latch line (RCLK), or of
+ * chip select if no latch line is given. Inputs are loaded by a low pulse
+ * on the \a load line (SH/LD) before the transfer; without it, the inputs
+ * must be loaded by other means, e.g. by chip select wired to SH/LD.
+ */
+class ShiftRegisterGoo: public VirtualGoo
+{
+	private:
+		SPI *spi;
+		int outs;
+		int ins;
+		int bytes;
+		GPIOpin *latch;
+		int latchBit;
+		GPIOpin *load;
+		int loadBit;
+		std::vector<uint8_t> tx;
+		std::vector<uint8_t> rx;
+
+	protected:
+		virtual int findLine(const char *name);
+		virtual bool canChangeDirection(int)
+		{
+			return false;
+		}
+		;
+
+		/**
+		 * Shifts the outputs out and the inputs in with one transfer. The
+		 * load pulse is only given when reading, and the latch pulse only
+		 * when writing; with chip select as the latch, unchanged outputs are
+		 * latched again.
+		 */
+		virtual int update(bool write, bool read);
+
+	public:
+		/**
+		 * @param spi Opened SPI client, not owned
+		 * @param outputs Number of output lines, 8 per 74HC595
+		 * @param inputs Number of input lines, 8 per 74HC165
+		 * @param latch Block with the RCLK line, or NULL to latch with chip select
+		 * @param latchBit Bit of RCLK in the block
+		 * @param load Block with the SH/LD line, or NULL
+		 * @param loadBit Bit of SH/LD in the block
+		 */
+		ShiftRegisterGoo(SPI *spi, int outputs, int inputs, GPIOpin *latch =
+				nullptr, int latchBit = 0, GPIOpin *load = nullptr, int loadBit = 0);
+		virtual ~ShiftRegisterGoo();
+};
+
+#endif /* SHIFTREGISTERGOO_H_ */
@@ -0,0 +1,52 @@
+/*
+ * monotonic.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef IOOO_MONOTONIC_H_
+#define IOOO_MONOTONIC_H_
+
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+/*
+ * Time helpers on CLOCK_MONOTONIC, in nanoseconds, for use inside the
+ * library.
+ */
+
+/**
+ * @return Current monotonic time in ns
+ */
+static inline uint64_t monotonicNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @param ns Time in ns
+ * @return The time as a timespec
+ */
+static inline struct timespec toTimespec(uint64_t ns)
+{
+	struct timespec ts;
+	ts.tv_sec = ns / 1000000000ull;
+	ts.tv_nsec = ns % 1000000000ull;
+	return ts;
+}
+
+/**
+ * Sleeps until a monotonic time, resuming after signals.
+ * @param ns Time to wake up, in ns
+ */
+static inline void sleepUntil(uint64_t ns)
+{
+	struct timespec ts = toTimespec(ns);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+#endif /* IOOO_MONOTONIC_H_ */
@@ -0,0 +1,278 @@
+/*
+ * BME280.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/BME280.h"
+#include "debug.h"
+#include "monotonic.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define BME280_RESET_WORD 0xB6
+#define BME280_STATUS_IM_UPDATE 0x01
+
+// Measurement values of skipped measurements
+#define BME280_SKIPPED_20BIT 0x80000
+#define BME280_SKIPPED_16BIT 0x8000
+
+#ifndef BME280_RESET_POLLS
+#define BME280_RESET_POLLS 10
+#endif
+
+static uint16_t le16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/*
+ * Worst case conversion time of one measurement, in us (datasheet 9.1)
+ */
+static uint32_t conversionTime(int os)
+{
+	return os == 0 ? 0 : 2300 * (1 << (os - 1));
+}
+
+BME280::BME280(I2C *i2c) :
+		i2c(i2c), chipId(0), T1(0), T2(0), T3(0), P1(0), P2(0), P3(0), P4(
+				0), P5(0), P6(0), P7(0), P8(0), P9(0), H1(0), H3(0), H2(0), H4(
+				0), H5(0), H6(0), mode(modeSleep), ctrlMeas(0), measureTime(0), period(
+				0), nextRead(0)
+{
+	memset(data, 0, sizeof(data));
+}
+
+BME280::~BME280()
+{
+}
+
+int BME280::writePairs(const uint8_t *pairs, int num)
+{
+	return i2c->write(pairs, num * 2) < 0 ? -1 : 0;
+}
+
+int BME280::init()
+{
+	uint8_t id;
+	if (i2c->readRegister(RegChipId, &id, 1) < 0)
+		return -1;
+	if (id != ChipIdBME280 && id != ChipIdBMP280)
+	{
+		iooo_error("BME280::init() error: Unknown chip ID 0x%02x.\n", id);
+		errno = ENODEV;
+		return -1;
+	}
+	chipId = id;
+
+	const uint8_t reset[2] =
+	{ RegReset, BME280_RESET_WORD };
+	if (writePairs(reset, 1) < 0)
+		return -1;
+	mode = modeSleep;
+
+	// Startup takes 2 ms, then the calibration is copied from NVM
+	uint8_t status = BME280_STATUS_IM_UPDATE;
+	for (int i = 0; i < BME280_RESET_POLLS && (status & BME280_STATUS_IM_UPDATE);
+			i++)
+	{
+		sleepUntil(monotonicNow() + 2000000ull);
+		if (i2c->readRegister(RegStatus, &status, 1, false) < 0)
+			status = BME280_STATUS_IM_UPDATE;
+	}
+	if (status & BME280_STATUS_IM_UPDATE)
+	{
+		iooo_error("BME280::init() error: Sensor did not come out of reset.\n");
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	// 0x88-0xA1 and 0xE1-0xE7, little-endian
+	uint8_t c[26];
+	if (i2c->readRegister(RegCalib00, c, sizeof(c)) < 0)
+		return -1;
+	T1 = le16(c);
+	T2 = le16(c + 2);
+	T3 = le16(c + 4);
+	P1 = le16(c + 6);
+	P2 = le16(c + 8);
+	P3 = le16(c + 10);
+	P4 = le16(c + 12);
+	P5 = le16(c + 14);
+	P6 = le16(c + 16);
+	P7 = le16(c + 18);
+	P8 = le16(c + 20);
+	P9 = le16(c + 22);
+
+	if (hasHumidity())
+	{
+		H1 = c[25];
+		uint8_t h[7];
+		if (i2c->readRegister(RegCalib26, h, sizeof(h)) < 0)
+			return -1;
+		H2 = le16(h);
+		H3 = h[2];
+		// H4 and H5 are 12 bits, sharing the nibbles of 0xE5
+		H4 = ((int8_t) h[3] * 16) | (h[4] & 0x0F);
+		H5 = ((int8_t) h[5] * 16) | (h[4] >> 4);
+		H6 = h[6];
+	}
+
+	iooo_debug(2, "BME280::init(): chip 0x%02x, T1=%u T2=%d T3=%d\n", chipId,
+			T1, T2, T3);
+	return 0;
+}
+
+int BME280::configure(Mode mode, Oversampling temperature,
+		Oversampling pressure, Oversampling humidity, Filter filter,
+		Standby standby)
+{
+	if (!hasHumidity())
+		humidity = osSkip;
+
+	// ctrl_hum only takes effect with the write to ctrl_meas after it, and
+	// config may be ignored outside sleep mode, so the mode goes last
+	ctrlMeas = (temperature << 5) | (pressure << 2);
+	const uint8_t sleep[2] =
+	{ RegCtrlMeas, ctrlMeas };
+	const uint8_t pairs[8] =
+	{ RegCtrlHum, (uint8_t) humidity, RegConfig, (uint8_t) ((standby << 5)
+			| (filter << 2)), RegCtrlMeas, (uint8_t) (ctrlMeas
+			| (mode == modeForced ? modeSleep : mode)) };
+	if ((this->mode != modeSleep && writePairs(sleep, 1) < 0)
+			|| (hasHumidity() ? writePairs(pairs, 3) : writePairs(pairs + 2, 2))
+					< 0)
+	{
+		iooo_error("BME280::configure() error: Unable to write configuration.\n");
+		return -1;
+	}
+	this->mode = mode;
+
+	measureTime = 1250 + conversionTime(temperature);
+	if (pressure != osSkip)
+		measureTime += conversionTime(pressure) + 575;
+	if (humidity != osSkip)
+		measureTime += conversionTime(humidity) + 575;
+
+	static const uint32_t standbyBME[8] =
+	{ 500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000 };
+	static const uint32_t standbyBMP[8] =
+	{ 500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000 };
+	period = measureTime
+			+ (hasHumidity() ? standbyBME[standby] : standbyBMP[standby]);
+
+	// The first result is ready after one measurement
+	nextRead = monotonicNow() + measureTime * 1000ull;
+	return 0;
+}
+
+int BME280::trigger()
+{
+	const uint8_t pairs[2] =
+	{ RegCtrlMeas, (uint8_t) (ctrlMeas | modeForced) };
+	if (writePairs(pairs, 1) < 0)
+	{
+		iooo_error("BME280::trigger() error: Unable to start a measurement.\n");
+		return -1;
+	}
+	return 0;
+}
+
+int BME280::read(Sample &sample)
+{
+	// Pressure, temperature and humidity in one burst; the sensor
+	// shadows the data registers for the duration of the burst
+	int len = hasHumidity() ? 8 : 6;
+	if (i2c->readRegister(RegData, data, len) < 0)
+		return -1;
+
+	int32_t adcP = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+	int32_t adcT = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+	int32_t adcH = hasHumidity() ? (data[6] << 8) | data[7] : BME280_SKIPPED_16BIT;
+
+	if (adcT == BME280_SKIPPED_20BIT)
+	{
+		iooo_error("BME280::read() error: No temperature measurement.\n");
+		errno = ENODATA;
+		return -1;
+	}
+
+	int32_t tFine;
+	sample.temperature = compensateT(adcT, tFine);
+	sample.pressure =
+			adcP == BME280_SKIPPED_20BIT ? 0 : compensateP(adcP, tFine);
+	sample.humidity =
+			adcH == BME280_SKIPPED_16BIT ? 0 : compensateH(adcH, tFine);
+	return 0;
+}
+
+int BME280::measure(Sample &sample)
+{
+	if (trigger() < 0)
+		return -1;
+	sleepUntil(monotonicNow() + measureTime * 1000ull);
+	return read(sample);
+}
+
+int BME280::readNext(Sample &sample)
+{
+	if (mode != modeNormal)
+		return measure(sample);
+
+	sleepUntil(nextRead);
+	int rc = read(sample);
+
+	// Keep the phase; if the caller fell behind, start over from now
+	uint64_t t = monotonicNow();
+	nextRead += period * 1000ull;
+	if (nextRead < t)
+		nextRead = t + period * 1000ull;
+	return rc;
+}
+
+/*
+ * Compensation formulas from the BME280 datasheet, section 4.2.3
+ */
+
+int32_t BME280::compensateT(int32_t adc, int32_t &tFine)
+{
+	int32_t var1 = ((((adc >> 3) - ((int32_t) T1 << 1))) * ((int32_t) T2))
+			>> 11;
+	int32_t var2 = (((((adc >> 4) - ((int32_t) T1))
+			* ((adc >> 4) - ((int32_t) T1))) >> 12) * ((int32_t) T3)) >> 14;
+	tFine = var1 + var2;
+	return (tFine * 5 + 128) >> 8;
+}
+
+uint32_t BME280::compensateP(int32_t adc, int32_t tFine)
+{
+	int64_t var1 = ((int64_t) tFine) - 128000;
+	int64_t var2 = var1 * var1 * (int64_t) P6;
+	var2 = var2 + ((var1 * (int64_t) P5) * 131072);
+	var2 = var2 + (((int64_t) P4) * 34359738368ll);
+	var1 = ((var1 * var1 * (int64_t) P3) >> 8) + ((var1 * (int64_t) P2) * 4096);
+	var1 = (((((int64_t) 1) << 47) + var1)) * ((int64_t) P1) >> 33;
+	if (var1 == 0)
+		return 0; // Avoid a division by zero
+	int64_t p = 1048576 - adc;
+	p = (((p << 31) - var2) * 3125) / var1;
+	var1 = (((int64_t) P9) * (p >> 13) * (p >> 13)) >> 25;
+	var2 = (((int64_t) P8) * p) >> 19;
+	p = ((p + var1 + var2) >> 8) + (((int64_t) P7) << 4);
+	return (uint32_t) p;
+}
+
+uint32_t BME280::compensateH(int32_t adc, int32_t tFine)
+{
+	int32_t v = tFine - ((int32_t) 76800);
+	v = (((((adc << 14) - (((int32_t) H4) << 20) - (((int32_t) H5) * v))
+			+ ((int32_t) 16384)) >> 15)
+			* (((((((v * ((int32_t) H6)) >> 10)
+					* (((v * ((int32_t) H3)) >> 11) + ((int32_t) 32768))) >> 10)
+					+ ((int32_t) 2097152)) * ((int32_t) H2) + 8192) >> 14));
+	v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t) H1)) >> 4));
+	v = (v < 0 ? 0 : v);
+	v = (v > 419430400 ? 419430400 : v);
+	return (uint32_t) (v >> 12);
+}
@@ -151,20 +151,26 @@ GPIOpin *BeagleGoo::claim(char* names[], int num, gpioWriteSemantics semantics,
 		return NULL;
 	}
 
-	if (num == 0)
+	if (num <= 0)
 	{
 		iooo_debug(1, "BeagleGoo::claim(): num is 0\n");
 		return NULL;
 	}
 
-	GPIOInfo **pininfos = new GPIOInfo*[num];
+	if (num > BeagleGooP::MaxPins)
+	{
+		iooo_debug(1, "BeagleGoo::claim(): num is larger than %i\n",
+				BeagleGooP::MaxPins);
+		return NULL;
+	}
+
+	GPIOInfo *pininfos[BeagleGooP::MaxPins];
 	for (int i = 0; i < num; i++)
 	{
 		pininfos[i] = _findGpio(names[i]);
 		if (pininfos[i] == NULL)
 		{
 			iooo_debug(1, "Pin '%s' is not a valid GPIO pin\n", names[i]);
-			delete[] pininfos;
 			return NULL;
 		}
 
@@ -174,7 +180,6 @@ GPIOpin *BeagleGoo::claim(char* names[], int num, gpioWriteSemantics semantics,
 		{
 			iooo_debug(0, "Pin '%s' already claimed and can not be shared\n",
 					names[i]);
-			delete[] pininfos;
 			return NULL;
 		}
 		iooo_debug(2,
@@ -184,18 +189,21 @@ GPIOpin *BeagleGoo::claim(char* names[], int num, gpioWriteSemantics semantics,
 
 	iooo_debug(3, "Creating BeagleGooP\n");
 	BeagleGooP *pin = new BeagleGooP(num, semantics, this);
+	if (pin == NULL)
+	{
+		iooo_debug(0, "BeagleGoo::claim(): no free pin blocks\n");
+		return NULL;
+	}
 
 	iooo_debug(3, "Adding pins\n");
 	for (int i = 0; i < num; i++)
 	{
 		iooo_debug(3, "Adding pin %i\n", i);
 		pin->addPin(pininfos[i]);
-		pininfos[i]->refCounter++;
 		if (flags & gpioExclusive)
 			pininfos[i]->flags |= GPIOoo::gpioExclusive;
 	}
 
-	delete[] pininfos;
 	iooo_debug(3, "BeagleGoo::claim: finish\n");
 	return pin;
 }
@@ -217,3 +225,46 @@ void BeagleGoo::release(GPIOpin** gpio)
 	delete *gpio;
 	*gpio = NULL;
 }
+
+void BeagleGoo::snapshot(Snapshot &snapshot)
+{
+	for (int i = 0; i < 4; i++)
+		snapshot.mask[i] = 0;
+	for (unsigned int i = 0; i < gpioCount; i++)
+		if (gpioInfos[i].refCounter > 0)
+			snapshot.mask[gpioInfos[i].gpioNum] |= 1u << gpioInfos[i].bitNum;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (!active || snapshot.mask[i] == 0)
+		{
+			snapshot.oe[i] = 0;
+			snapshot.dataOut[i] = 0;
+			continue;
+		}
+		snapshot.oe[i] = gpios[i][GpioOeReg / 4] & snapshot.mask[i];
+		snapshot.dataOut[i] = gpios[i][DataOutReg / 4] & snapshot.mask[i];
+	}
+}
+
+void BeagleGoo::restore(const Snapshot &snapshot)
+{
+	if (!active)
+	{
+		iooo_debug(1, "BeagleGoo::restore: BeagleGoo not active\n");
+		return;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (snapshot.mask[i] == 0)
+			continue;
+		//values first, then direction, so new outputs start with the right level
+		uint32_t tmp = gpios[i][DataOutReg / 4];
+		gpios[i][DataOutReg / 4] = (tmp & ~snapshot.mask[i])
+				| (snapshot.dataOut[i] & snapshot.mask[i]);
+		tmp = gpios[i][GpioOeReg / 4];
+		gpios[i][GpioOeReg / 4] = (tmp & ~snapshot.mask[i])
+				| (snapshot.oe[i] & snapshot.mask[i]);
+	}
+}
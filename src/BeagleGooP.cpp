@@ -8,33 +8,55 @@
 #include "beaglebone/BeagleGooP.h"
 #include <string.h>
 #include <stdio.h>
+#include <atomic>
+#include <type_traits>
 #include "debug.h"
 
-#define DATA_OUT_REG    0x13C
-#define DATA_IN_REG     0x138
-#define GPIO_OE_REG     0x134
-//spru73h pg 4093
-#define DATA_CLEAR_REG  0x190
-//spru73h pg 4094
-#define DATA_SET_REG    0x194
+/**
+ * Storage for pin blocks. Blocks are constructed in one of the slots by
+ * BeagleGooP::operator new, so claiming and releasing pins never touches the heap.
+ */
+static std::aligned_storage<sizeof(BeagleGooP), alignof(BeagleGooP)>::type blockPool[BeagleGooP::MaxBlocks];
+static std::atomic<bool> blockUsed[BeagleGooP::MaxBlocks];
+
+void *BeagleGooP::operator new(size_t size) noexcept
+{
+	if (size > sizeof(blockPool[0]))
+		return NULL;
+	for (int i = 0; i < MaxBlocks; i++)
+	{
+		bool expected = false;
+		if (blockUsed[i].compare_exchange_strong(expected, true))
+			return &blockPool[i];
+	}
+	iooo_debug(0, "BeagleGooP::operator new(): all %i blocks in use\n", MaxBlocks);
+	return NULL;
+}
+
+void BeagleGooP::operator delete(void *p)
+{
+	for (int i = 0; i < MaxBlocks; i++)
+		if (p == &blockPool[i])
+		{
+			blockUsed[i] = false;
+			return;
+		}
+}
 
 BeagleGooP::BeagleGooP(int num, BeagleGoo::gpioWriteSemantics semantics,
 		BeagleGoo *parent):GPIOpin()
 {
 	this->parent = parent;
-	this->num = num;
-	pins = new BeagleGoo::GPIOInfo *[num];
-	localNames = new char *[num];
-	ports = new uint32_t[num];
-	masks = new uint32_t[num];
+	this->num = num > MaxPins ? MaxPins : num;
 	writeSemantics = semantics;
 	current = 0;
 
-	for(int i=0;i<num;i++)
+	for(int i=0;i<MaxPins;i++)
 	{
 		ports[i]=0;
 		masks[i]=0;
 		pins[i]=NULL;
+		localNames[i][0]=0;
 	}
 	iooo_debug(2,"BeagleGooP::BeagleGooP(): done\n");
 }
@@ -54,16 +76,7 @@ BeagleGooP::~BeagleGooP()
 		//clear gpioExclusive pin if present
 		if (pins[i]->flags & GPIOoo::gpioExclusive)
 			pins[i]->flags &= ~GPIOoo::gpioExclusive;
-		//if has been allocated, delete local storage for local pin name
-		if (localNames[i] != pins[i]->name)
-			delete[] localNames[i];
 	}
-
-	//free memory allocated for arrays
-	delete[] ports;
-	delete[] masks;
-	delete[] localNames;
-	delete[] pins;
 }
 
 int BeagleGooP::addPin(BeagleGoo::GPIOInfo *pin)
@@ -77,7 +90,8 @@ int BeagleGooP::addPin(BeagleGoo::GPIOInfo *pin)
 	pins[current] = pin;
 	ports[current] = pin->gpioNum;
 	masks[current] = 1 << (pin->bitNum);
-	localNames[current] = pin->name;
+	strncpy(localNames[current], pin->name, BeagleGoo::MaxGpioNameLen);
+	localNames[current][BeagleGoo::MaxGpioNameLen] = 0;
 	pin->refCounter++;
 	iooo_debug(2,
 			"BeagleGooP::addPin(): current=%i, pin->gpioNum=%i, pin->bitNum=%i, masks=%08x, localNames=\"%s\"\n",
@@ -90,17 +104,12 @@ int BeagleGooP::addPin(BeagleGoo::GPIOInfo *pin)
 
 void BeagleGooP::namePin(int i, char* name)
 {
-	if (i >= current)
+	if (i < 0 || i >= current)
 		return;
-	//if localNames[i]==pins[i]->name then local name is just a reference to the system pin name.
-	//If so, local storage has to be allocated.
+	//Names are kept in fixed-size storage inside the block, long names are truncated.
 	iooo_debug(2,"Naming pin %i as \"%s\" (formerly \"%s\")\n",i,name,localNames[i]);
-	if (localNames[i] == pins[i]->name)
-		localNames[i] = new char[BeagleGoo::MaxGpioNameLen + 1];
-	for(int j=0;j<BeagleGoo::MaxGpioNameLen + 1;j++)
-		localNames[i][j]=0;
-	//memset(localNames[i], 0, BeagleGoo::MaxGpioNameLen + 1);
 	strncpy(localNames[i],name,BeagleGoo::MaxGpioNameLen);
+	localNames[i][BeagleGoo::MaxGpioNameLen]=0;
 }
 
 void BeagleGooP::namePins(char *names[])
@@ -135,13 +144,13 @@ void BeagleGooP::enableOutput(int i, bool enable)
 	iooo_debug(2,
 			"BeagleGooP::enableOutput(): enabling pin %i (%s): port=%i, mask=%08x, OE_REG=%08x\n",
 			i, localNames[i], ports[i], masks[i],
-			parent->gpios[ports[i]][GPIO_OE_REG / 4]);
+			parent->gpios[ports[i]][BeagleGoo::GpioOeReg / 4]);
 	if (enable)
-		parent->gpios[ports[i]][GPIO_OE_REG / 4] &= ~masks[i];
+		parent->gpios[ports[i]][BeagleGoo::GpioOeReg / 4] &= ~masks[i];
 	else
-		parent->gpios[ports[i]][GPIO_OE_REG / 4] |= masks[i];
+		parent->gpios[ports[i]][BeagleGoo::GpioOeReg / 4] |= masks[i];
 	iooo_debug(2,"BeagleGooP::enableOutput(): port=%i, mask=%08x, OE_REG=%08x\n",
-			ports[i], masks[i], parent->gpios[ports[i]][GPIO_OE_REG / 4]);
+			ports[i], masks[i], parent->gpios[ports[i]][BeagleGoo::GpioOeReg / 4]);
 }
 
 void BeagleGooP::enableOutput(int* outs, int num)
@@ -153,41 +162,37 @@ void BeagleGooP::enableOutput(int* outs, int num)
 				current, num);
 		return;
 	}
-	bool *oe=new bool[current];
-	for (int i = 0; i < current; i++)
-		oe[i] = false;
+	uint32_t oe = 0;
 	for (int i = 0; i < num; i++)
 	{
-		if (outs[i] < 0 || outs[i] > current)
+		if (outs[i] < 0 || outs[i] >= current)
 			continue;
-		oe[outs[i]] = true;
+		oe |= 1u << outs[i];
 	}
 	for (int i = 0; i < current; i++)
-		enableOutput(i, oe[i]);
-	delete[] oe;
+		enableOutput(i, (oe >> i) & 1);
 }
 
 void BeagleGooP::enableOutput(char** outNames, int num)
 {
 	iooo_debug(2,"BeagleGooP::enableOutput(names): enabling %i named pins\n", num);
-	if (outNames == NULL || num <= 0 || num >= current)
+	if (outNames == NULL || num <= 0 || num > current)
 	{
 		iooo_debug(0,"BeagleGooP::enableOutput(): fail\n");
 		return;
 	}
-	bool *oe=new bool[current];
-	for (int i = 0; i < current; i++)
-		oe[i] = false;
+	uint32_t oe = 0;
 	for (int i = 0; i < num; i++)
 	{
 		if (outNames[i] == NULL)
 			continue;
 		int out = findPinIndex(outNames[i]);
-		oe[out] = true;
+		if (out < 0)
+			continue;
+		oe |= 1u << out;
 	}
 	for (int i = 0; i < current; i++)
-		enableOutput(i, oe[i]);
-	delete[] oe;
+		enableOutput(i, (oe >> i) & 1);
 }
 
 void BeagleGooP::write(uint32_t v)
@@ -214,10 +219,10 @@ void BeagleGooP::write(uint32_t v)
 			{
 				if (portBitmasks[i] == 0)
 					continue;
-				uint32_t tmp = parent->gpios[i][DATA_OUT_REG / 4];
+				uint32_t tmp = parent->gpios[i][BeagleGoo::DataOutReg / 4];
 				tmp &= ~portBitmasks[i];
 				tmp |= valueBitmasks[i];
-				parent->gpios[i][DATA_OUT_REG / 4] = tmp;
+				parent->gpios[i][BeagleGoo::DataOutReg / 4] = tmp;
 			}
 			break;
 		}
@@ -241,16 +246,16 @@ void BeagleGooP::write(uint32_t v)
 			{
 				for (int i = 0; i < 4; i++)
 				{
-					parent->gpios[i][DATA_SET_REG / 4] = setBits[i];
-					parent->gpios[i][DATA_CLEAR_REG / 4] = clearBits[i];
+					parent->gpios[i][BeagleGoo::DataSetReg / 4] = setBits[i];
+					parent->gpios[i][BeagleGoo::DataClearReg / 4] = clearBits[i];
 				}
 			}
 			else
 			{
 				for (int i = 0; i < 4; i++)
 				{
-					parent->gpios[i][DATA_CLEAR_REG / 4] = clearBits[i];
-					parent->gpios[i][DATA_SET_REG / 4] = setBits[i];
+					parent->gpios[i][BeagleGoo::DataClearReg / 4] = clearBits[i];
+					parent->gpios[i][BeagleGoo::DataSetReg / 4] = setBits[i];
 				}
 			}
 			break;
@@ -268,7 +273,7 @@ void BeagleGooP::setBit(int bit)
 {
 	if (bit < 0 || bit >= current)
 		return;
-	parent->gpios[ports[bit]][DATA_SET_REG/4]=masks[bit];
+	parent->gpios[ports[bit]][BeagleGoo::DataSetReg/4]=masks[bit];
 }
 
 void BeagleGooP::set(uint32_t v)
@@ -283,7 +288,7 @@ void BeagleGooP::set(uint32_t v)
 		m = m << 1;
 	}
 	for (int i = 0; i < 4; i++)
-		parent->gpios[i][DATA_SET_REG / 4] = setBits[i];
+		parent->gpios[i][BeagleGoo::DataSetReg / 4] = setBits[i];
 
 }
 
@@ -291,7 +296,7 @@ void BeagleGooP::clearBit(int bit)
 {
 	if (bit < 0 || bit >= current)
 		return;
-	parent->gpios[ports[bit]][DATA_CLEAR_REG/4]=masks[bit];
+	parent->gpios[ports[bit]][BeagleGoo::DataClearReg/4]=masks[bit];
 }
 
 void BeagleGooP::clear(uint32_t v)
@@ -306,14 +311,14 @@ void BeagleGooP::clear(uint32_t v)
 		m = m << 1;
 	}
 	for (int i = 0; i < 4; i++)
-		parent->gpios[i][DATA_CLEAR_REG / 4] = clearBits[i];
+		parent->gpios[i][BeagleGoo::DataClearReg / 4] = clearBits[i];
 }
 
 uint32_t BeagleGooP::read()
 {
 	uint32_t tmp[4];
 	for (int i = 0; i < 4; i++)
-		tmp[i] = parent->gpios[i][DATA_IN_REG / 4];
+		tmp[i] = parent->gpios[i][BeagleGoo::DataInReg / 4];
 
 	uint32_t r = 0;
 	uint32_t m = 1;
@@ -325,3 +330,62 @@ uint32_t BeagleGooP::read()
 	}
 	return r;
 }
+
+void BeagleGooP::saveState(State &state)
+{
+	uint32_t oe[4];
+	uint32_t out[4];
+	for (int i = 0; i < 4; i++)
+	{
+		oe[i] = parent->gpios[i][BeagleGoo::GpioOeReg / 4];
+		out[i] = parent->gpios[i][BeagleGoo::DataOutReg / 4];
+	}
+
+	state.outputs = 0;
+	state.values = 0;
+	uint32_t m = 1;
+	for (int i = 0; i < current; i++)
+	{
+		//OE register bit cleared means output enabled
+		if (!(oe[ports[i]] & masks[i]))
+			state.outputs |= m;
+		if (out[ports[i]] & masks[i])
+			state.values |= m;
+		m = m << 1;
+	}
+}
+
+void BeagleGooP::restoreState(const State &state)
+{
+	uint32_t portBitmasks[4] =
+		{ 0, 0, 0, 0 };
+	uint32_t inputBits[4] =
+		{ 0, 0, 0, 0 };
+	uint32_t valueBits[4] =
+		{ 0, 0, 0, 0 };
+
+	uint32_t m = 1;
+	for (int i = 0; i < current; i++)
+	{
+		portBitmasks[ports[i]] |= masks[i];
+		if (!(state.outputs & m))
+			inputBits[ports[i]] |= masks[i];
+		if (state.values & m)
+			valueBits[ports[i]] |= masks[i];
+		m = m << 1;
+	}
+
+	//one store to DATA_OUT and one to OE per bank. Values go first, so
+	//lines switched to output do not glitch.
+	for (int i = 0; i < 4; i++)
+	{
+		if (portBitmasks[i] == 0)
+			continue;
+		uint32_t tmp = parent->gpios[i][BeagleGoo::DataOutReg / 4];
+		parent->gpios[i][BeagleGoo::DataOutReg / 4] = (tmp & ~portBitmasks[i])
+				| valueBits[i];
+		tmp = parent->gpios[i][BeagleGoo::GpioOeReg / 4];
+		parent->gpios[i][BeagleGoo::GpioOeReg / 4] = (tmp & ~portBitmasks[i])
+				| inputBits[i];
+	}
+}
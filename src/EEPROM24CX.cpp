@@ -53,7 +53,7 @@ long int EEPROM24CX::read(size_t pos, size_t size, void* rbuf)
 		return -1;
 	}
 
-	if (eepromSize != EEPROM_UNKNOWN && pos + size >= eepromSize)
+	if (eepromSize != EEPROM_UNKNOWN && pos + size > eepromSize)
 	{
 		iooo_error(
 				"EEPROM24CX::read() warning: Trying to read past end of memory. Data will be truncated.\n");
@@ -95,27 +95,28 @@ long int EEPROM24CX::write(size_t pos, size_t size, const void* wbuf)
 		return -1;
 	}
 
-	if (eepromSize != EEPROM_UNKNOWN && pos + size >= eepromSize)
+	if (eepromSize != EEPROM_UNKNOWN && pos + size > eepromSize)
 	{
 		iooo_error(
 				"EEPROM24CX::write() warning: Trying to write past end of memory. Data truncated.\n");
 		size = eepromSize - pos;
 	}
 
-	// Do in page-sized chunks
-	int i = 0;
-	int remaining = size;
+	// Do in page-sized chunks. Writes wrap around within a page,
+	// so each chunk ends at a page boundary.
+	size_t offset = 0;
 	int written = 0;
 	do
 	{
 		if (waitForCompletion())
 		{
-			size_t offset = i * pageSize;
 			size_t addr = pos + offset;
 			// Create a pointer to the data at the current page offset
 			const void *data = &((const unsigned char *) wbuf)[offset];
 
-			size_t writeSize = pageSize > remaining ? remaining : pageSize;
+			size_t writeSize = pageSize - addr % pageSize;
+			if (writeSize > size - offset)
+				writeSize = size - offset;
 
 			iooo_debug(4, "Writing page of length %d to 0x%x\n", writeSize,
 					addr);
@@ -142,15 +143,13 @@ long int EEPROM24CX::write(size_t pos, size_t size, const void* wbuf)
 			else
 				written += w;
 
-			remaining -= pageSize;
+			offset += writeSize;
 		}
 		else
 		{
 			written = -1;
 		}
-
-		i++;
-	} while (remaining > 0 && written >= 0);
+	} while (offset < size && written >= 0);
 
 	return written;
 }
@@ -160,7 +159,7 @@ long int EEPROM24CX::erase()
 	std::vector<unsigned char> buf(pageSize, 0xFF);
 	int written = 0;
 
-	for (int i = 0; i < eepromSize - pageSize; i += pageSize)
+	for (size_t i = 0; i < eepromSize; i += pageSize)
 	{
 		int rc = write(i, pageSize, &buf[0]);
 
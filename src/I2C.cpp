@@ -6,33 +6,22 @@
  */
 
 #include "I2C.h"
+#include "I2CQueue.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <linux/i2c-dev.h>
 
-#define MAX_PATH_LEN 20
-#define I2C_DEVICE_PATH_BASE "/dev/i2c-"
-
-#define KERNEL_BUS(bus) bus
-#ifdef _HW_PLATFORM_BEAGLEBONE
-#ifdef _KERNEL_VERSION
-// I2C1 and I2C2 are switched in BeagleBone kernel 3.x, but not 4.x
-#undef KERNEL_BUS
-#define KERNEL_MAJ_VER _KERNEL_VERSION[0]
-#define KERNEL_BUS(bus) KERNEL_MAJ_VER == '3' ? (bus == 2 ? 1 : (bus == 1 ? 2 : bus)) : bus
-#endif
-#endif
-
-I2C::I2C()
+I2C::I2C() :
+		pending(0)
 {
-	activeBus = -1;
+	bus = nullptr;
 	activeAddr = -1;
-	fd = -1;
 	tenbit = false;
-	supportedFuncs = 0;
 
 	transactionState = false;
+	numMsgs = 0;
+	scratchUsed = 0;
 }
 
 I2C::I2C(int bus, int slaveAddr) :
@@ -41,62 +30,59 @@ I2C::I2C(int bus, int slaveAddr) :
 	open(bus, slaveAddr);
 }
 
+I2C::I2C(I2CBus *bus, int slaveAddr) :
+		I2C()
+{
+	open(bus, slaveAddr);
+}
+
 /*
  * Opening and closing
  */
 
 int I2C::open(int bus)
 {
-	if (activeBus >= 0)
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (this->bus != nullptr)
 	{
 		close();
 	}
 
-	// Check parameter
-	if (bus < 0)
-	{
-		iooo_error("I2C::open() error: Bus number is invalid.\n");
-		errno = EINVAL;
+	I2CBus *b = I2CBus::acquire(bus);
+	if (b == nullptr)
 		return -1;
-	}
 
-	// Check device path
-	char path[MAX_PATH_LEN];
-	if (snprintf(path, MAX_PATH_LEN, "%s%d", I2C_DEVICE_PATH_BASE,
-			KERNEL_BUS(bus)) >= MAX_PATH_LEN)
-	{
-		iooo_error("I2C::open() error: Bus number is too long.\n");
-		errno = ENAMETOOLONG;
-		return -1;
-	}
+	this->bus = b;
+	return b->getFd();
+}
 
-	// Open device for read/write
-	if ((fd = ::open(path, O_RDWR)) < 0)
+int I2C::open(I2CBus *bus)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (this->bus != nullptr)
 	{
-		iooo_error("I2C::open() open(%s) error: %s (%d)\n", path,
-				strerror(errno), errno);
-		return fd; // fd is negative
+		close();
 	}
 
-	// Get supported functionality
-	if (ioctl(fd, I2C_FUNCS, &supportedFuncs) < 0)
+	if (bus == nullptr || !bus->isOpen())
 	{
-		iooo_error("I2C::open() ioctl(I2C_FUNCS) error: %s\n", strerror(errno));
+		iooo_error("I2C::open() error: Bus is not open.\n");
+		errno = EINVAL;
 		return -1;
 	}
 
-	activeBus = bus;
-
-	return fd;
+	this->bus = bus;
+	return 0;
 }
 
 int I2C::setSlave(int slaveAddr, bool ignoreChecks)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
 	if (!busReady())
 		return -1;
 
-	// Check slaveAddr number is within valid space
-	if (slaveAddr <= 0x08 && (slaveAddr <= 0x77 || slaveAddr > 0x7F))
+	// 7-bit addresses 0x00-0x07 and 0x78-0x7F are reserved
+	if (slaveAddr < 0x08 || (slaveAddr > 0x77 && slaveAddr <= 0x7F))
 	{
 		iooo_error("I2C::setSlave() error: Address number is invalid.\n");
 		errno = EINVAL;
@@ -116,27 +102,19 @@ int I2C::setSlave(int slaveAddr, bool ignoreChecks)
 			return -1;
 		}
 
-		// If 10-bit mode is requested, check compatiblity and enable
-		if (!(supportedFuncs & I2C_FUNC_10BIT_ADDR))
+		// If 10-bit mode is requested, check compatiblity. Messages are
+		// flagged with I2C_M_TEN.
+		if (!(bus->getFuncs() & I2C_FUNC_10BIT_ADDR))
 		{
 			iooo_error(
 					"I2C::setSlave() error: 10-bit mode is not supported with this device.\n");
 			errno = ENOTSUP;
 			return -1;
 		}
-
-		if (ioctl(fd, I2C_TENBIT, 1) < 0)
-		{
-			iooo_error("I2C::setSlave() ioctl(I2C_TENBIT, 1) error: %s (%d)\n",
-					strerror(errno), errno);
-			return -1;
-		}
-
-		this->tenbit = true;
-
 	}
 
 	activeAddr = slaveAddr;
+	tenbit = slaveAddr > 0x7F;
 
 	// Check if the device exists
 	if (!ignoreChecks)
@@ -146,35 +124,14 @@ int I2C::setSlave(int slaveAddr, bool ignoreChecks)
 			iooo_error(
 					"I2C::open() probe() Unable to connect to address 0x%x on bus %i: "
 							"the device is not responding to probes.\n",
-					activeAddr, activeBus);
+					activeAddr, bus->getBus());
+			activeAddr = -1;
 			errno = ENODEV;
 			return -1;
 		}
 	}
 
-	// Set the destination slaveAddr
-	// No longer needed - now using ioctl for reads and writes
-	if (ioctl(fd, I2C_SLAVE, slaveAddr) < 0)
-	{
-		if (errno == EBUSY)
-		{
-			if (!ignoreChecks)
-			{
-				iooo_error(
-						"I2C::setSlave() ioctl(slave=%i) warning: Device is currently being "
-								"used by another driver, proceed with caution.\n",
-						slaveAddr);
-			}
-		}
-		else
-		{
-			iooo_error("I2C::setSlave() ioctl(slave=%i) error: %s (%d)\n",
-					slaveAddr, strerror(errno), errno);
-			return -1;
-		}
-	}
-
-	return fd;
+	return 0;
 }
 
 int I2C::open(int bus, int slaveAddr, bool ignoreChecks)
@@ -187,21 +144,29 @@ int I2C::open(int bus, int slaveAddr, bool ignoreChecks)
 	return fd;
 }
 
+int I2C::open(I2CBus *bus, int slaveAddr, bool ignoreChecks)
+{
+	if (open(bus) < 0)
+		return -1;
+	return setSlave(slaveAddr, ignoreChecks);
+}
+
 int I2C::close()
 {
-	if (activeBus < 0)
+	flush();
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (bus == nullptr)
 		return 0;
 
-	if ((::close(fd)) != 0)
-	{
-		iooo_error("I2C::close() close() error: %s (%d)\n", strerror(errno),
-				errno);
-		return -1;
-	}
+	if (transactionState)
+		abortTransaction(false);
 
-	activeBus = -1;
+	I2CBus::release(bus);
+
+	bus = nullptr;
 	activeAddr = -1;
-	fd = -1;
+	tenbit = false;
 	return 0;
 }
 
@@ -222,7 +187,7 @@ bool I2C::probe()
 
 bool I2C::busReady()
 {
-	return activeBus < 0 ? false : true;
+	return bus == nullptr ? false : true;
 }
 
 bool I2C::slaveReady()
@@ -241,7 +206,7 @@ bool I2C::isReady()
 
 int I2C::getActiveBus()
 {
-	return activeBus;
+	return bus == nullptr ? -1 : bus->getBus();
 }
 
 int I2C::getActiveAddress()
@@ -249,6 +214,11 @@ int I2C::getActiveAddress()
 	return activeAddr;
 }
 
+I2CBus *I2C::getBus()
+{
+	return bus;
+}
+
 /*
  * Other settings
  */
@@ -263,6 +233,11 @@ void I2C::setByteOrder(I2C::byte_order order)
 	byteOrder = order;
 }
 
+void I2C::setSharedBatches(bool enable)
+{
+	sharedBatches = enable;
+}
+
 /*
  * Error checking
  */
@@ -272,7 +247,7 @@ int I2C::enablePEC()
 	if (!isReady())
 		return -1;
 
-	if (!(supportedFuncs & I2C_FUNC_SMBUS_PEC))
+	if (!(bus->getFuncs() & I2C_FUNC_SMBUS_PEC))
 	{
 		iooo_error(
 				"I2C::enablePEC() error: PEC is not supported with this device.\n");
@@ -280,7 +255,8 @@ int I2C::enablePEC()
 		return -1;
 	}
 
-	if (ioctl(fd, I2C_PEC, 1) < 0)
+	std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+	if (ioctl(bus->getFd(), I2C_PEC, 1) < 0)
 	{
 		iooo_error("I2C::enablePEC() error: %s (%d)\n", strerror(errno), errno);
 		return -1;
@@ -294,7 +270,8 @@ int I2C::disablePEC()
 	if (!isReady())
 		return -1;
 
-	if (ioctl(fd, I2C_PEC, 0) < 0)
+	std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+	if (ioctl(bus->getFd(), I2C_PEC, 0) < 0)
 	{
 		iooo_error("I2C::disablePEC() ioctl(I2C_PEC, 0) error: %s (%d)\n",
 				strerror(errno), errno);
@@ -310,116 +287,85 @@ int I2C::disablePEC()
 
 int I2C::read(void *rbuf, size_t length, bool noAck, bool showErrors)
 {
-	if (!isReady())
-		return -1;
-
-	struct i2c_msg msg;
-
-	msg.addr = activeAddr;
-	msg.len = length;
-	msg.flags = I2C_M_RD;
-	msg.flags |= noAck ? I2C_M_NO_RD_ACK : 0;
-	msg.flags |= tenbit ? I2C_M_TEN : 0;
-	msg.buf = (typeof(msg.buf)) rbuf;
+	std::lock_guard<std::recursive_mutex> guard(lock);
 
-	msgs.push_back(msg);
-
-	// If not currently in a transaction, commit the read now
-	if (!transactionState)
+	// A single byte is an SMBus receive byte
+	if (isReady() && !transactionState && length == 1 && bus->useSMBus()
+			&& (bus->getFuncs() & I2C_FUNC_SMBUS_READ_BYTE))
 	{
-
-		struct i2c_rdwr_ioctl_data msgset;
-
-		msgset.nmsgs = 1;
-		msgset.msgs = &msgs[0];
-
-		if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+		union i2c_smbus_data data;
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		if (bus->smbus(activeAddr, tenbit, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE,
+				&data) < 0)
 		{
 			if (showErrors)
-				iooo_error("I2C::read() ioctl(I2C_RDWR) error: %s (%d)\n",
+				iooo_error("I2C::read() SMBus error: %s (%d)\n",
 						strerror(errno), errno);
-			msgs.clear();
 			return -1;
 		}
+		*(unsigned char *) rbuf = data.byte;
+		return 1;
+	}
 
-		// Swap read byte order if required
-		if (byteOrder == LSB_first)
-			swapByteOrder(msg.buf, msg.len);
+	int rc = queue(rbuf, length, I2C_M_RD | (noAck ? I2C_M_NO_RD_ACK : 0),
+			showErrors);
 
-		msgs.clear();
-		return length;
+	// Swap read byte order if required. Reads in a transaction are
+	// swapped when it is committed.
+	if (rc > 0 && byteOrder == LSB_first)
+		swapByteOrder((unsigned char *) rbuf, length);
 
-	}
-	else
-	{
-		return 0;
-	}
+	return rc;
 }
 
 int I2C::write(const void *wbuf, size_t length, bool ignoreNack,
 		bool showErrors)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
 	if (!isReady())
 		return -1;
 
-	struct i2c_msg msg;
-
-	msg.addr = activeAddr;
-	msg.len = length;
-	msg.flags = 0;
-	msg.flags |= ignoreNack ? I2C_M_IGNORE_NAK : 0;
-	msg.flags |= tenbit ? I2C_M_TEN : 0;
-	msg.buf = (typeof(msg.buf)) wbuf;
-
-	// Swap write byte order if required
-	if (byteOrder == LSB_first)
-		swapByteOrder(msg.buf, msg.len);
-
-	msgs.push_back(msg);
-
-	// If not in a transaction, commit the write now
-	if (!transactionState)
+	// A single byte is an SMBus send byte
+	if (!transactionState && length == 1 && bus->useSMBus()
+			&& (bus->getFuncs() & I2C_FUNC_SMBUS_WRITE_BYTE))
 	{
-
-		struct i2c_rdwr_ioctl_data msgset;
-
-		msgset.nmsgs = 1;
-		msgset.msgs = &msgs[0];
-		if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		if (bus->smbus(activeAddr, tenbit, I2C_SMBUS_WRITE,
+				*(const unsigned char *) wbuf, I2C_SMBUS_BYTE, nullptr) < 0)
 		{
 			if (showErrors)
-				iooo_error("I2C::write() ioctl(I2C_RDWR) error: %s (%d)\n",
+				iooo_error("I2C::write() SMBus error: %s (%d)\n",
 						strerror(errno), errno);
-			msgs.clear();
 			return -1;
 		}
-
-		msgs.clear();
-		return length;
-
-	}
-	else
-	{
-		return 0;
+		return 1;
 	}
+
+	return queue(ordered(wbuf, length), length,
+			ignoreNack ? I2C_M_IGNORE_NAK : 0, showErrors);
 }
 
 int I2C::writeRead(const void *wbuf, size_t wlength, void *rbuf, size_t rlength,
-		bool ignoreNack, bool noAck, bool showErrors)
+		bool noAck, bool ignoreNack, bool showErrors)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
 	bool was_transaction = true;
 
 	// If not already in a transaction, make a transaction state
 	if (!transactionState)
 	{
 		was_transaction = false;
-		beginTransaction();
+		if (beginTransaction(showErrors) < 0)
+			return -1;
 	}
 
-	if (write(wbuf, wlength, ignoreNack, showErrors) < 0)
-		return -1;
-	if (read(rbuf, rlength, noAck, showErrors) < 0)
+	if (write(wbuf, wlength, ignoreNack, showErrors) < 0
+			|| read(rbuf, rlength, noAck, showErrors) < 0)
+	{
+		if (!was_transaction)
+			abortTransaction(false);
 		return -1;
+	}
 
 	// Commit transaction if the system was not already in a
 	// transaction state
@@ -449,44 +395,306 @@ int I2C::writeWrite(const void *w1buf, size_t w1length, const void *w2buf,
 	// There's no need for a reset in a double write
 	// And in fact, when writing to registers, sometimes
 	// having a reset in the middle is unsupported!
-	void *wbuf = malloc(w1length + w2length);
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!isReady())
+		return -1;
 
-	// Construct a single data packet of w2 appended to w1
-	memcpy(wbuf, w1buf, w1length);
+	bool was_transaction = transactionState;
+	if (!was_transaction && beginTransaction(showErrors) < 0)
+		return -1;
 
-	void *lsb = (unsigned char*) (wbuf) + w1length;
-	memcpy(lsb, w2buf, w2length);
+	unsigned short flags = ignoreNack ? I2C_M_IGNORE_NAK : 0;
+	int result;
+#ifdef I2C_FUNC_NOSTART
+	if ((bus->getFuncs() & I2C_FUNC_NOSTART) && w1length > 0 && w2length > 0)
+	{
+		// Second buffer continues the first message without a start. The
+		// first one is usually a register address on the caller's stack.
+		unsigned char *w1 = allocBuffer(w1length);
+		orderedCopy(w1, w1buf, w1length);
+		result = queue(w1, w1length, flags, showErrors);
+		if (result >= 0)
+			result = queue(ordered(w2buf, w2length), w2length,
+					flags | I2C_M_NOSTART, showErrors);
+	}
+	else
+#endif
+	{
+		// Construct a single data packet of w2 appended to w1
+		unsigned char *wbuf = allocBuffer(w1length + w2length);
+		orderedCopy(wbuf, w1buf, w1length);
+		orderedCopy(wbuf + w1length, w2buf, w2length);
 
-	// Write in a single hit
-	int result = write(wbuf, w1length + w2length, ignoreNack, showErrors);
-	free(wbuf);
+		// Write in a single hit
+		result = queue(wbuf, w1length + w2length, flags, showErrors);
+	}
 
-	if (!transactionState && result >= 0)
-		return w2length;
-	else
+	if (was_transaction)
 		return result;
+
+	if (result < 0)
+	{
+		abortTransaction(false);
+		return -1;
+	}
+	if (endTransaction(showErrors) < 0)
+		return -1;
+	return w2length;
 }
 
 int I2C::readRegister(unsigned char reg_addr, void *rbuf, size_t length,
 		bool showErrors)
 {
-	return writeRead(&reg_addr, 1, rbuf, length, false, false, showErrors);
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!isReady())
+		return -1;
+
+	if (!transactionState)
+	{
+		if (readRaw(reg_addr, rbuf, length, showErrors) < 0)
+			return -1;
+
+		// Swap read byte order if required
+		if (byteOrder == LSB_first)
+			swapByteOrder((unsigned char *) rbuf, length);
+		return length;
+	}
+
+	// The address must outlive a transaction
+	unsigned char *reg = allocBuffer(1);
+	*reg = reg_addr;
+	return writeRead(reg, 1, rbuf, length, false, false, showErrors);
 }
 
 int I2C::writeRegister(unsigned char reg_addr, const void *wbuf, size_t length,
 		bool showErrors)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!isReady())
+		return -1;
+
+	// Without I2C_M_NOSTART, short writes are joined in the scratch area,
+	// which also suits the SMBus
+	bool join = true;
+#ifdef I2C_FUNC_NOSTART
+	join = bus->useSMBus() || !(bus->getFuncs() & I2C_FUNC_NOSTART);
+#endif
+	if (!transactionState && length < I2C_SCRATCH_SIZE && join)
+	{
+		unsigned char *frame = allocBuffer(1 + length);
+		frame[0] = reg_addr;
+		orderedCopy(frame + 1, wbuf, length);
+		return writeRaw(frame, length, showErrors);
+	}
+
 	return writeWrite(&reg_addr, 1, wbuf, length, false, showErrors);
 }
 
+int I2C::readRaw(unsigned char reg_addr, void *rbuf, size_t length,
+		bool showErrors)
+{
+	if (!isReady())
+		return -1;
+
+	if (transactionState)
+	{
+		if (showErrors)
+			iooo_error(
+					"I2C::readRegisters() error: Typed reads cannot be part of a transaction.\n");
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (bus->useSMBus())
+	{
+		if (smbusAccess(I2C_SMBUS_READ, reg_addr, (unsigned char *) rbuf,
+				length) >= 0)
+			return length;
+
+		// Reads the SMBus cannot express go through I2C_RDWR
+		if (errno != EOPNOTSUPP || !(bus->getFuncs() & I2C_FUNC_I2C))
+		{
+			if (showErrors)
+				iooo_error("I2C::readRegister() SMBus error: %s (%d)\n",
+						strerror(errno), errno);
+			return -1;
+		}
+	}
+
+	if (addMessage(&reg_addr, 1, 0, showErrors) == nullptr
+			|| addMessage(rbuf, length, I2C_M_RD, showErrors) == nullptr)
+	{
+		resetTransaction();
+		return -1;
+	}
+
+	int rc;
+	{
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		rc = bus->transfer(msgs, numMsgs);
+	}
+	resetTransaction();
+
+	if (rc < 0)
+	{
+		// The adapter has no I2C_RDWR; use the SMBus from now on
+		if (errno == EOPNOTSUPP && !bus->useSMBus())
+		{
+			bus->setSMBus(true);
+			return readRaw(reg_addr, rbuf, length, showErrors);
+		}
+
+		if (showErrors)
+			iooo_error("I2C::readRegister() transfer error: %s (%d)\n",
+					strerror(errno), errno);
+		return -1;
+	}
+
+	return length;
+}
+
+int I2C::writeRaw(unsigned char *frame, size_t length, bool showErrors)
+{
+	if (bus->useSMBus())
+	{
+		int rc = smbusAccess(I2C_SMBUS_WRITE, frame[0], frame + 1, length);
+		if (rc >= 0)
+		{
+			resetTransaction();
+			return length;
+		}
+
+		// Writes the SMBus cannot express go through I2C_RDWR
+		if (errno != EOPNOTSUPP || !(bus->getFuncs() & I2C_FUNC_I2C))
+		{
+			if (showErrors)
+				iooo_error("I2C::writeRegister() SMBus error: %s (%d)\n",
+						strerror(errno), errno);
+			resetTransaction();
+			return -1;
+		}
+	}
+
+	if (addMessage(frame, 1 + length, 0, showErrors) == nullptr)
+	{
+		resetTransaction();
+		return -1;
+	}
+
+	int rc;
+	{
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		rc = bus->transfer(msgs, numMsgs);
+	}
+	numMsgs = 0;
+
+	if (rc < 0)
+	{
+		// The adapter has no I2C_RDWR; use the SMBus from now on
+		if (errno == EOPNOTSUPP && !bus->useSMBus())
+		{
+			bus->setSMBus(true);
+			return writeRaw(frame, length, showErrors);
+		}
+
+		if (showErrors)
+			iooo_error("I2C::writeRegister() transfer error: %s (%d)\n",
+					strerror(errno), errno);
+		resetTransaction();
+		return -1;
+	}
+
+	resetTransaction();
+	return length;
+}
+
+int I2C::smbusAccess(char readWrite, unsigned char command,
+		unsigned char *buf, size_t length)
+{
+	bool rd = readWrite == I2C_SMBUS_READ;
+	unsigned long func;
+	int size;
+
+	// Registers of 1 and 2 bytes map to byte and word data, longer ones
+	// to I2C block transfers
+	if (length == 1)
+	{
+		size = I2C_SMBUS_BYTE_DATA;
+		func = rd ? I2C_FUNC_SMBUS_READ_BYTE_DATA :
+				I2C_FUNC_SMBUS_WRITE_BYTE_DATA;
+	}
+	else if (length == 2)
+	{
+		size = I2C_SMBUS_WORD_DATA;
+		func = rd ? I2C_FUNC_SMBUS_READ_WORD_DATA :
+				I2C_FUNC_SMBUS_WRITE_WORD_DATA;
+	}
+	else if (length > 0 && length <= I2C_SMBUS_BLOCK_MAX)
+	{
+		size = I2C_SMBUS_I2C_BLOCK_DATA;
+		func = rd ? I2C_FUNC_SMBUS_READ_I2C_BLOCK :
+				I2C_FUNC_SMBUS_WRITE_I2C_BLOCK;
+	}
+	else
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	if ((bus->getFuncs() & func) != func)
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	// SMBus words go low byte first, as the bytes of the register do
+	union i2c_smbus_data data;
+	if (size == I2C_SMBUS_BYTE_DATA)
+		data.byte = buf[0];
+	else if (size == I2C_SMBUS_WORD_DATA)
+		data.word = buf[0] | (buf[1] << 8);
+	else
+	{
+		data.block[0] = length;
+		if (!rd)
+			memcpy(data.block + 1, buf, length);
+	}
+
+	{
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		if (bus->smbus(activeAddr, tenbit, readWrite, command, size, &data)
+				< 0)
+			return -1;
+	}
+
+	if (rd)
+	{
+		if (size == I2C_SMBUS_BYTE_DATA)
+			buf[0] = data.byte;
+		else if (size == I2C_SMBUS_WORD_DATA)
+		{
+			buf[0] = data.word & 0xFF;
+			buf[1] = data.word >> 8;
+		}
+		else
+			memcpy(buf, data.block + 1, length);
+	}
+
+	return length;
+}
+
 /*
  * Transactions
  */
 
 int I2C::beginTransaction(bool showErrors)
 {
+	// Kept until the transaction ends
+	lock.lock();
+
 	if (transactionState)
 	{
+		lock.unlock();
 		if (showErrors)
 			iooo_error(
 					"I2C::beginTransaction() error: A transaction is already in progress. End or abort the current transaction first.\n");
@@ -495,15 +703,19 @@ int I2C::beginTransaction(bool showErrors)
 	}
 
 	if (!isReady())
+	{
+		lock.unlock();
 		return -1;
+	}
 
 	transactionState = true;
-	msgs.clear();
+	resetTransaction();
 	return 0;
 }
 
 int I2C::endTransaction(bool showErrors)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
 	if (!transactionState)
 	{
 		if (showErrors)
@@ -516,40 +728,38 @@ int I2C::endTransaction(bool showErrors)
 		return -1;
 
 	transactionState = false;
-
-	// Swap write byte order if required
-	if (byteOrder == LSB_first)
-		for (i2c_msg msg : msgs)
-			if (msg.flags & I2C_M_RD == 0)
-				swapByteOrder(msg.buf, msg.len);
-
-	struct i2c_rdwr_ioctl_data msgset;
-
-	msgset.nmsgs = msgs.size();
-	msgset.msgs = &msgs[0];
+	lock.unlock();
 
 	int totalBytes = 0;
-	for (i2c_msg m : msgs)
+	for (int i = 0; i < numMsgs; i++)
+	{
+		totalBytes += msgs[i].len;
+	}
+
+	int rc = 0;
+	if (numMsgs > 0)
 	{
-		totalBytes += m.len;
+		std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+		rc = bus->transfer(msgs, numMsgs);
 	}
 
-	if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+	if (rc < 0)
 	{
 		if (showErrors)
 			iooo_error("I2C::endTransaction() error: %s (%d)\n",
 					strerror(errno), errno);
-		msgs.clear();
+		resetTransaction();
 		return -1;
 	}
 
-	// Swap read byte order if required
+	// Swap read byte order if required. Writes were swapped when they
+	// were queued.
 	if (byteOrder == LSB_first)
-		for (i2c_msg msg : msgs)
-			if (msg.flags & I2C_M_RD > 0)
-				swapByteOrder(msg.buf, msg.len);
+		for (int i = 0; i < numMsgs; i++)
+			if ((msgs[i].flags & I2C_M_RD) != 0)
+				swapByteOrder(msgs[i].buf, msgs[i].len);
 
-	msgs.clear();
+	resetTransaction();
 
 	return totalBytes;
 }
@@ -561,6 +771,7 @@ int I2C::endTransaction(bool showErrors)
  */
 void I2C::abortTransaction(bool showErrors)
 {
+	std::lock_guard<std::recursive_mutex> guard(lock);
 	if (!transactionState)
 	{
 		if (showErrors)
@@ -570,13 +781,199 @@ void I2C::abortTransaction(bool showErrors)
 	}
 
 	transactionState = false;
-	msgs.clear();
+	lock.unlock();
+	resetTransaction();
 	return;
 }
 
+/*
+ * Asynchronous transactions
+ */
+
+std::future<int> I2C::submit(int priority)
+{
+	std::future<int> result;
+
+	int r = queueRequest(priority, std::function<void(int)>(), &result);
+	if (r < 0)
+	{
+		std::promise<int> failed;
+		failed.set_value(r);
+		return failed.get_future();
+	}
+	return result;
+}
+
+int I2C::submit(std::function<void(int)> callback, int priority)
+{
+	return queueRequest(priority, callback, nullptr);
+}
+
+int I2C::queueRequest(int priority, std::function<void(int)> callback,
+		std::future<int> *result)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!transactionState)
+	{
+		iooo_error("I2C::submit() error: There is no currently active transaction.\n");
+		return -EPERM;
+	}
+
+	if (numMsgs == 0 || !(bus->getFuncs() & I2C_FUNC_I2C))
+	{
+		iooo_error("I2C::submit() error: %s\n",
+				numMsgs == 0 ? "Empty transaction." :
+						"The adapter does not support I2C_RDWR.");
+		abortTransaction(false);
+		return numMsgs == 0 ? -EINVAL : -EOPNOTSUPP;
+	}
+
+	I2CQueue::Request *req = new I2CQueue::Request;
+	req->client = this;
+	req->priority = priority;
+	req->msgs.assign(msgs, msgs + numMsgs);
+	req->data.assign(scratch, scratch + scratchUsed);
+	req->heapBuffers.swap(heapBuffers);
+	req->swapReads = byteOrder == LSB_first;
+	req->shared = sharedBatches;
+	req->len = 0;
+	for (struct i2c_msg &msg : req->msgs)
+	{
+		// Messages in the scratch area move with the transaction
+		if (msg.buf >= scratch && msg.buf < scratch + scratchUsed)
+			msg.buf = &req->data[0] + (msg.buf - scratch);
+		req->len += msg.len;
+	}
+	req->callback = callback;
+	if (result != nullptr)
+		*result = req->promise.get_future();
+
+	transactionState = false;
+	lock.unlock();
+	resetTransaction();
+
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		pending++;
+	}
+	bus->getQueue()->submit(req);
+	return 1;
+}
+
+void I2C::flush()
+{
+	std::unique_lock<std::mutex> guard(pendingLock);
+	idle.wait(guard, [this]
+	{	return pending == 0;});
+}
+
 /*
  * Private utilities
  */
+struct i2c_msg *I2C::addMessage(void *buf, size_t length, unsigned short flags,
+		bool showErrors)
+{
+	if (numMsgs >= I2C_RDWR_IOCTL_MAX_MSGS)
+	{
+		if (showErrors)
+			iooo_error(
+					"I2C::addMessage() error: More than %d messages in a transaction.\n",
+					I2C_RDWR_IOCTL_MAX_MSGS);
+		errno = E2BIG;
+		return nullptr;
+	}
+
+	struct i2c_msg *msg = &msgs[numMsgs++];
+	msg->addr = activeAddr;
+	msg->flags = flags | (tenbit ? I2C_M_TEN : 0);
+	msg->len = length;
+	msg->buf = (typeof(msg->buf)) buf;
+	return msg;
+}
+
+unsigned char *I2C::allocBuffer(size_t length)
+{
+	if (scratchUsed + length <= I2C_SCRATCH_SIZE)
+	{
+		unsigned char *buf = scratch + scratchUsed;
+		scratchUsed += length;
+		return buf;
+	}
+
+	unsigned char *buf = new unsigned char[length];
+	heapBuffers.push_back(buf);
+	return buf;
+}
+
+int I2C::queue(void *buf, size_t length, unsigned short flags,
+		bool showErrors)
+{
+	if (!isReady())
+		return -1;
+
+	if (addMessage(buf, length, flags, showErrors) == nullptr)
+	{
+		if (!transactionState)
+			resetTransaction();
+		return -1;
+	}
+
+	// If not in a transaction, commit the message now
+	if (!transactionState)
+	{
+		int rc;
+		{
+			std::lock_guard<std::recursive_mutex> busGuard(bus->getLock());
+			rc = bus->transfer(msgs, numMsgs);
+		}
+		resetTransaction();
+
+		if (rc < 0)
+		{
+			if (showErrors)
+				iooo_error("I2C::%s() transfer error: %s (%d)\n",
+						(flags & I2C_M_RD) ? "read" : "write", strerror(errno),
+						errno);
+			return -1;
+		}
+
+		return length;
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+void I2C::orderedCopy(unsigned char *dst, const void *src, size_t length)
+{
+	const unsigned char *s = (const unsigned char *) src;
+	if (byteOrder == LSB_first)
+		for (size_t i = 0; i < length; i++)
+			dst[i] = s[length - 1 - i];
+	else
+		memcpy(dst, s, length);
+}
+
+void *I2C::ordered(const void *buf, size_t length)
+{
+	if (byteOrder != LSB_first || length < 2)
+		return (void *) buf;
+
+	unsigned char *copy = allocBuffer(length);
+	orderedCopy(copy, buf, length);
+	return copy;
+}
+
+void I2C::resetTransaction()
+{
+	numMsgs = 0;
+	scratchUsed = 0;
+	for (unsigned char *buf : heapBuffers)
+		delete[] buf;
+	heapBuffers.clear();
+}
+
 void I2C::swapByteOrder(unsigned char *target, size_t length)
 {
 	// Swapping algorithm - tmp is the temporary space to put
@@ -595,4 +992,5 @@ void I2C::swapByteOrder(unsigned char *target, size_t length)
 I2C::~I2C()
 {
 	close();
+	resetTransaction();
 }
@@ -0,0 +1,250 @@
+/*
+ * I2CBus.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "I2CBus.h"
+#include "I2CQueue.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+#define MAX_PATH_LEN 20
+#define I2C_DEVICE_PATH_BASE "/dev/i2c-"
+#define I2C_SYSFS_PATH "/sys/class/i2c-dev"
+
+#define KERNEL_BUS(bus) bus
+#ifdef _HW_PLATFORM_BEAGLEBONE
+#ifdef _KERNEL_VERSION
+// I2C1 and I2C2 are switched in BeagleBone kernel 3.x, but not 4.x
+#undef KERNEL_BUS
+#define KERNEL_MAJ_VER _KERNEL_VERSION[0]
+#define KERNEL_BUS(bus) KERNEL_MAJ_VER == '3' ? (bus == 2 ? 1 : (bus == 1 ? 2 : bus)) : bus
+#endif
+#endif
+
+std::mutex I2CBus::registryLock;
+std::map<int, I2CBus *> I2CBus::registry;
+
+I2CBus::I2CBus()
+{
+	users = 0;
+	shared = false;
+	busNum = -1;
+	fd = -1;
+	supportedFuncs = 0;
+	smbusPreferred = false;
+	slaveAddr = -1;
+	slaveTenbit = false;
+	queue = new I2CQueue(this);
+}
+
+int I2CBus::open(int bus)
+{
+	if (busNum >= 0)
+		close();
+
+	// Check parameter
+	if (bus < 0)
+	{
+		iooo_error("I2CBus::open() error: Bus number is invalid.\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Check device path
+	char path[MAX_PATH_LEN];
+	if (snprintf(path, MAX_PATH_LEN, "%s%d", I2C_DEVICE_PATH_BASE,
+			KERNEL_BUS(bus)) >= MAX_PATH_LEN)
+	{
+		iooo_error("I2CBus::open() error: Bus number is too long.\n");
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	// Open device for read/write
+	if ((fd = ::open(path, O_RDWR)) < 0)
+	{
+		iooo_error("I2CBus::open() open(%s) error: %s (%d)\n", path,
+				strerror(errno), errno);
+		return -1;
+	}
+
+	// Get supported functionality
+	if (ioctl(fd, I2C_FUNCS, &supportedFuncs) < 0)
+	{
+		iooo_error("I2CBus::open() ioctl(I2C_FUNCS) error: %s\n",
+				strerror(errno));
+		::close(fd);
+		fd = -1;
+		return -1;
+	}
+
+	busNum = bus;
+	smbusPreferred = !(supportedFuncs & I2C_FUNC_I2C);
+	slaveAddr = -1;
+	slaveTenbit = false;
+	return 0;
+}
+
+int I2CBus::close()
+{
+	if (busNum < 0)
+		return 0;
+
+	if (fd >= 0 && ::close(fd) != 0)
+	{
+		iooo_error("I2CBus::close() close() error: %s (%d)\n", strerror(errno),
+				errno);
+		return -1;
+	}
+
+	busNum = -1;
+	fd = -1;
+	supportedFuncs = 0;
+	slaveAddr = -1;
+	return 0;
+}
+
+int I2CBus::transfer(struct i2c_msg *msgs, int num)
+{
+	struct i2c_rdwr_ioctl_data msgset;
+
+	msgset.nmsgs = num;
+	msgset.msgs = msgs;
+
+	return ioctl(fd, I2C_RDWR, &msgset);
+}
+
+int I2CBus::smbus(int addr, bool tenbit, char readWrite, uint8_t command,
+		int size, union i2c_smbus_data *data)
+{
+	if (tenbit != slaveTenbit)
+	{
+		if (ioctl(fd, I2C_TENBIT, tenbit ? 1 : 0) < 0)
+			return -1;
+		slaveTenbit = tenbit;
+		slaveAddr = -1;
+	}
+
+	if (addr != slaveAddr)
+	{
+		// I2C_RDWR does not check for kernel drivers either
+		if (ioctl(fd, I2C_SLAVE, addr) < 0)
+		{
+			if (errno != EBUSY || ioctl(fd, I2C_SLAVE_FORCE, addr) < 0)
+			{
+				slaveAddr = -1;
+				return -1;
+			}
+			iooo_debug(1,
+					"I2CBus::smbus() warning: Address 0x%x is used by a kernel driver.\n",
+					addr);
+		}
+		slaveAddr = addr;
+	}
+
+	struct i2c_smbus_ioctl_data args;
+
+	args.read_write = readWrite;
+	args.command = command;
+	args.size = size;
+	args.data = data;
+
+	return ioctl(fd, I2C_SMBUS, &args) < 0 ? -1 : 0;
+}
+
+int I2CBus::find(const char *name)
+{
+	DIR *dir = opendir(I2C_SYSFS_PATH);
+	if (dir == nullptr)
+	{
+		iooo_error("I2CBus::find() opendir(%s) error: %s (%d)\n",
+				I2C_SYSFS_PATH, strerror(errno), errno);
+		return -1;
+	}
+
+	int bus = -1;
+	struct dirent *entry;
+	while (bus < 0 && (entry = readdir(dir)) != nullptr)
+	{
+		int num;
+		if (sscanf(entry->d_name, "i2c-%d", &num) != 1)
+			continue;
+
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s/name", I2C_SYSFS_PATH,
+				entry->d_name);
+		FILE *f = fopen(path, "r");
+		if (f == nullptr)
+			continue;
+
+		char adapter[64];
+		if (fgets(adapter, sizeof(adapter), f) != nullptr)
+		{
+			adapter[strcspn(adapter, "\n")] = 0;
+			if (strcmp(adapter, name) == 0)
+				bus = num;
+		}
+		fclose(f);
+	}
+	closedir(dir);
+
+	if (bus < 0)
+		errno = ENODEV;
+	return bus;
+}
+
+I2CBus *I2CBus::acquire(int bus)
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+
+	auto i = registry.find(bus);
+	if (i != registry.end())
+	{
+		i->second->users++;
+		return i->second;
+	}
+
+	I2CBus *b = new I2CBus();
+	if (b->open(bus) < 0)
+	{
+		int err = errno;
+		delete b;
+		errno = err;
+		return nullptr;
+	}
+	b->shared = true;
+	b->users = 1;
+	registry[bus] = b;
+	return b;
+}
+
+void I2CBus::release(I2CBus *bus)
+{
+	if (bus == nullptr || !bus->shared)
+		return;
+
+	std::lock_guard<std::mutex> guard(registryLock);
+	if (--bus->users > 0)
+		return;
+
+	registry.erase(bus->busNum);
+	delete bus;
+}
+
+I2CBus::~I2CBus()
+{
+	// Finish queued transactions while the adapter is still open
+	delete queue;
+	close();
+}
@@ -0,0 +1,552 @@
+/*
+ * I2CModel.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "I2CModel.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <linux/i2c-dev.h>
+
+/*
+ * Register file
+ */
+
+I2CRegisterModel::I2CRegisterModel(unsigned int numRegs, uint8_t fill) :
+		regs(numRegs > 256 ? 256 : (numRegs == 0 ? 1 : numRegs), fill), pointer(
+				0), first(false)
+{
+}
+
+bool I2CRegisterModel::start(bool read)
+{
+	first = !read;
+	return true;
+}
+
+bool I2CRegisterModel::write(uint8_t byte)
+{
+	if (first)
+	{
+		pointer = byte % regs.size();
+		first = false;
+		return true;
+	}
+
+	regs[pointer] = byte;
+	pointer = (pointer + 1) % regs.size();
+	return true;
+}
+
+uint8_t I2CRegisterModel::read()
+{
+	uint8_t v = regs[pointer];
+	pointer = (pointer + 1) % regs.size();
+	return v;
+}
+
+/*
+ * 24-series EEPROM
+ */
+
+EEPROM24CXModel::EEPROM24CXModel(uint32_t size, uint32_t pageSize,
+		int addressBytes) :
+		memory(size, 0xFF), pageSize(pageSize), addressBytes(addressBytes), busyPolls(
+				3), busy(0), addr(0), position(0), page(pageSize), pageUsed(
+				pageSize, false)
+{
+}
+
+void EEPROM24CXModel::setBusyPolls(uint32_t polls)
+{
+	busyPolls = polls;
+}
+
+bool EEPROM24CXModel::start(bool /*read*/)
+{
+	if (busy > 0)
+	{
+		busy--;
+		stats.busyNacks++;
+		return false;
+	}
+
+	position = 0;
+	return true;
+}
+
+bool EEPROM24CXModel::write(uint8_t byte)
+{
+	if (position < addressBytes)
+	{
+		addr = position == 0 ? byte : (addr << 8) | byte;
+		if (++position == addressBytes)
+			addr %= memory.size();
+		return true;
+	}
+
+	// The address counter rolls over within the page
+	uint32_t offset = addr % pageSize;
+	page[offset] = byte;
+	pageUsed[offset] = true;
+	addr = addr - offset + (offset + 1) % pageSize;
+	position++;
+	return true;
+}
+
+uint8_t EEPROM24CXModel::read()
+{
+	uint8_t v = memory[addr];
+	addr = (addr + 1) % memory.size();
+	stats.reads++;
+	return v;
+}
+
+void EEPROM24CXModel::stop()
+{
+	bool written = false;
+	uint32_t base = addr - addr % pageSize;
+	for (uint32_t i = 0; i < pageSize; i++)
+	{
+		if (!pageUsed[i])
+			continue;
+		memory[base + i] = page[i];
+		pageUsed[i] = false;
+		written = true;
+	}
+
+	if (written)
+	{
+		stats.pageWrites++;
+		busy = busyPolls;
+	}
+	position = 0;
+}
+
+/*
+ * LTC2485
+ */
+
+LTC2485Model::LTC2485Model(double vref) :
+		vref(vref), input(0), conversionPolls(2), config(0), busy(0), position(
+				0), reading(false)
+{
+	convert();
+}
+
+void LTC2485Model::setInput(double volts)
+{
+	input = volts;
+}
+
+void LTC2485Model::setConversionPolls(uint32_t polls)
+{
+	conversionPolls = polls;
+}
+
+void LTC2485Model::convert()
+{
+	double fs = vref / 2;
+	uint32_t word;
+
+	// SIG and MSB: 11 overrange, 10 positive, 01 negative, 00 underrange
+	if (input >= fs)
+		word = 0xC0000000;
+	else if (input < -fs)
+		word = 0x3FFFFFC0;
+	else
+	{
+		int32_t code = floor(input / fs * 16777216.0);
+		word = 0x80000000u + ((uint32_t) code << 6);
+	}
+
+	for (int i = 0; i < 4; i++)
+		result[i] = word >> (24 - i * 8);
+}
+
+bool LTC2485Model::start(bool read)
+{
+	if (busy > 0)
+	{
+		busy--;
+		return false;
+	}
+
+	reading = read;
+	position = 0;
+	return true;
+}
+
+bool LTC2485Model::write(uint8_t byte)
+{
+	if (position++ == 0)
+		config = byte;
+	return true;
+}
+
+uint8_t LTC2485Model::read()
+{
+	return position < 4 ? result[position++] : 0xFF;
+}
+
+void LTC2485Model::stop()
+{
+	// Reading the result starts the next conversion
+	if (reading && position > 0)
+	{
+		convert();
+		busy = conversionPolls;
+	}
+	reading = false;
+	position = 0;
+}
+
+/*
+ * Emulated bus
+ */
+
+I2CEmulatedBus::I2CEmulatedBus(int bus, uint32_t speed) :
+		speed(speed), overhead(0), realTime(false)
+{
+	busNum = bus;
+	supportedFuncs = I2C_FUNC_I2C | I2C_FUNC_10BIT_ADDR
+			| I2C_FUNC_PROTOCOL_MANGLING | I2C_FUNC_NOSTART
+			| (I2C_FUNC_SMBUS_EMUL & ~I2C_FUNC_SMBUS_PEC)
+			| I2C_FUNC_SMBUS_READ_BLOCK_DATA;
+	smbusPreferred = false;
+}
+
+I2CEmulatedBus::~I2CEmulatedBus()
+{
+}
+
+void I2CEmulatedBus::attach(int addr, I2CDeviceModel *model)
+{
+	std::lock_guard<std::recursive_mutex> guard(getLock());
+	models[addr] = model;
+}
+
+void I2CEmulatedBus::detach(int addr)
+{
+	std::lock_guard<std::recursive_mutex> guard(getLock());
+	auto i = models.find(addr);
+	if (i == models.end())
+		return;
+	addressed.erase(i->second);
+	models.erase(i);
+}
+
+void I2CEmulatedBus::setTiming(uint32_t speed, uint32_t overhead)
+{
+	std::lock_guard<std::recursive_mutex> guard(getLock());
+	this->speed = speed;
+	this->overhead = overhead;
+}
+
+void I2CEmulatedBus::setRealTime(bool enable)
+{
+	std::lock_guard<std::recursive_mutex> guard(getLock());
+	realTime = enable;
+}
+
+void I2CEmulatedBus::setFuncs(unsigned long funcs)
+{
+	std::lock_guard<std::recursive_mutex> guard(getLock());
+	supportedFuncs = funcs;
+	smbusPreferred = !(funcs & I2C_FUNC_I2C);
+}
+
+void I2CEmulatedBus::stopAll()
+{
+	for (I2CDeviceModel *model : addressed)
+		model->stop();
+	addressed.clear();
+}
+
+void I2CEmulatedBus::spend(uint64_t ns)
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+
+	// Sleep through most of long transfers, spin for the rest
+	if (ns > 200000)
+		std::this_thread::sleep_for(std::chrono::nanoseconds(ns - 100000));
+	while (std::chrono::steady_clock::now() < end)
+		;
+}
+
+int I2CEmulatedBus::route(struct i2c_msg *msgs, int num, uint64_t &bits)
+{
+	I2CDeviceModel *current = nullptr;
+
+	for (int i = 0; i < num; i++)
+	{
+		struct i2c_msg &m = msgs[i];
+		bool read = m.flags & I2C_M_RD;
+		bool ignoreNak = m.flags & I2C_M_IGNORE_NAK;
+
+		stats.messages++;
+
+		if (i == 0 || !(m.flags & I2C_M_NOSTART))
+		{
+			// Start, address and acknowledge
+			bits += (m.flags & I2C_M_TEN) ? 1 + 18 : 1 + 9;
+
+			auto d = models.find(m.addr);
+			current = d == models.end() ? nullptr : d->second;
+			if (current != nullptr)
+				addressed.insert(current);
+
+			if (current == nullptr || !current->start(read))
+			{
+				stats.nacks++;
+				current = nullptr;
+				if (!ignoreNak)
+				{
+					errno = ENXIO;
+					return -1;
+				}
+			}
+		}
+
+		if (read)
+		{
+			int start = 0;
+			if (m.flags & I2C_M_RECV_LEN)
+			{
+				// SMBus block read, the first byte is the count
+				m.buf[0] = current != nullptr ? current->read() : 0xFF;
+				if (m.buf[0] == 0 || m.buf[0] > I2C_SMBUS_BLOCK_MAX)
+				{
+					errno = EPROTO;
+					return -1;
+				}
+				m.len = 1 + m.buf[0];
+				start = 1;
+			}
+			for (int j = start; j < m.len; j++)
+				m.buf[j] = current != nullptr ? current->read() : 0xFF;
+		}
+		else
+		{
+			for (int j = 0; j < m.len; j++)
+			{
+				if (current != nullptr && current->write(m.buf[j]))
+					continue;
+
+				stats.nacks++;
+				if (!ignoreNak)
+				{
+					bits += j * 9;
+					errno = EREMOTEIO;
+					return -1;
+				}
+			}
+		}
+
+		bits += m.len * 9;
+		stats.bytes += m.len;
+
+#ifdef I2C_M_STOP
+		if ((m.flags & I2C_M_STOP) && i < num - 1)
+		{
+			stopAll();
+			bits++;
+		}
+#endif
+	}
+
+	return num;
+}
+
+int I2CEmulatedBus::execute(struct i2c_msg *msgs, int num)
+{
+	uint64_t bits = 0;
+	int r = route(msgs, num, bits);
+
+	// Failed transfers end with a stop as well
+	stopAll();
+	bits++;
+
+	uint64_t ns = overhead;
+	if (speed > 0)
+		ns += bits * 1000000000ull / speed;
+	stats.busTime += ns;
+	if (realTime)
+		spend(ns);
+
+	return r;
+}
+
+int I2CEmulatedBus::transfer(struct i2c_msg *msgs, int num)
+{
+	stats.transfers++;
+
+	if (!(supportedFuncs & I2C_FUNC_I2C))
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+	if (num <= 0 || num > I2C_RDWR_IOCTL_MAX_MSGS)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return execute(msgs, num);
+}
+
+int I2CEmulatedBus::smbus(int addr, bool tenbit, char readWrite,
+		uint8_t command, int size, union i2c_smbus_data *data)
+{
+	stats.smbusCalls++;
+
+	bool rd = readWrite == I2C_SMBUS_READ;
+	unsigned long func;
+	switch (size)
+	{
+		case I2C_SMBUS_QUICK:
+			func = I2C_FUNC_SMBUS_QUICK;
+			break;
+		case I2C_SMBUS_BYTE:
+			func = rd ? I2C_FUNC_SMBUS_READ_BYTE : I2C_FUNC_SMBUS_WRITE_BYTE;
+			break;
+		case I2C_SMBUS_BYTE_DATA:
+			func = rd ? I2C_FUNC_SMBUS_READ_BYTE_DATA :
+					I2C_FUNC_SMBUS_WRITE_BYTE_DATA;
+			break;
+		case I2C_SMBUS_WORD_DATA:
+			func = rd ? I2C_FUNC_SMBUS_READ_WORD_DATA :
+					I2C_FUNC_SMBUS_WRITE_WORD_DATA;
+			break;
+		case I2C_SMBUS_BLOCK_DATA:
+			func = rd ? I2C_FUNC_SMBUS_READ_BLOCK_DATA :
+					I2C_FUNC_SMBUS_WRITE_BLOCK_DATA;
+			break;
+		case I2C_SMBUS_I2C_BLOCK_DATA:
+			func = rd ? I2C_FUNC_SMBUS_READ_I2C_BLOCK :
+					I2C_FUNC_SMBUS_WRITE_I2C_BLOCK;
+			break;
+		default:
+			func = 0;
+			break;
+	}
+	if (func == 0 || (supportedFuncs & func) != func)
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	if ((size == I2C_SMBUS_BLOCK_DATA && !rd)
+			|| size == I2C_SMBUS_I2C_BLOCK_DATA)
+	{
+		if (data->block[0] == 0 || data->block[0] > I2C_SMBUS_BLOCK_MAX)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	// Command byte, then data for writes; reads get a second message
+	uint8_t wbuf[I2C_SMBUS_BLOCK_MAX + 2];
+	uint8_t rbuf[I2C_SMBUS_BLOCK_MAX + 1];
+	unsigned short flags = tenbit ? I2C_M_TEN : 0;
+	struct i2c_msg msgs[2];
+	msgs[0].addr = addr;
+	msgs[0].flags = flags;
+	msgs[0].len = 1;
+	msgs[0].buf = wbuf;
+	msgs[1].addr = addr;
+	msgs[1].flags = flags | I2C_M_RD;
+	msgs[1].len = 0;
+	msgs[1].buf = rbuf;
+	wbuf[0] = command;
+	int num = rd ? 2 : 1;
+
+	switch (size)
+	{
+		case I2C_SMBUS_QUICK:
+			msgs[0].len = 0;
+			msgs[0].flags |= rd ? I2C_M_RD : 0;
+			num = 1;
+			break;
+		case I2C_SMBUS_BYTE:
+			if (rd)
+			{
+				msgs[0] = msgs[1];
+				msgs[0].len = 1;
+				num = 1;
+			}
+			break;
+		case I2C_SMBUS_BYTE_DATA:
+			if (rd)
+				msgs[1].len = 1;
+			else
+			{
+				wbuf[1] = data->byte;
+				msgs[0].len = 2;
+			}
+			break;
+		case I2C_SMBUS_WORD_DATA:
+			if (rd)
+				msgs[1].len = 2;
+			else
+			{
+				wbuf[1] = data->word & 0xFF;
+				wbuf[2] = data->word >> 8;
+				msgs[0].len = 3;
+			}
+			break;
+		case I2C_SMBUS_BLOCK_DATA:
+			if (rd)
+			{
+				msgs[1].flags |= I2C_M_RECV_LEN;
+				msgs[1].len = 1;
+			}
+			else
+			{
+				memcpy(wbuf + 1, data->block, data->block[0] + 1);
+				msgs[0].len = 2 + data->block[0];
+			}
+			break;
+		case I2C_SMBUS_I2C_BLOCK_DATA:
+			if (rd)
+				msgs[1].len = data->block[0];
+			else
+			{
+				memcpy(wbuf + 1, data->block + 1, data->block[0]);
+				msgs[0].len = 1 + data->block[0];
+			}
+			break;
+	}
+
+	if (execute(msgs, num) < 0)
+		return -1;
+
+	if (rd)
+	{
+		switch (size)
+		{
+			case I2C_SMBUS_BYTE:
+			case I2C_SMBUS_BYTE_DATA:
+				data->byte = rbuf[0];
+				break;
+			case I2C_SMBUS_WORD_DATA:
+				data->word = rbuf[0] | (rbuf[1] << 8);
+				break;
+			case I2C_SMBUS_BLOCK_DATA:
+				memcpy(data->block, rbuf, rbuf[0] + 1);
+				break;
+			case I2C_SMBUS_I2C_BLOCK_DATA:
+				memcpy(data->block + 1, rbuf, data->block[0]);
+				break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * I2CMux.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "I2CMux.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <string.h>
+
+/*
+ * Channels
+ */
+
+I2CMuxChannel::I2CMuxChannel(I2CMux *mux, int channel) :
+		mux(mux), channel(channel)
+{
+	// The parent keeps the adapter; a channel must not close it
+	busNum = mux->parent->getBus();
+	supportedFuncs = mux->parent->getFuncs();
+	smbusPreferred = mux->parent->useSMBus();
+}
+
+int I2CMuxChannel::transfer(struct i2c_msg *msgs, int num)
+{
+	return mux->transfer(channel, msgs, num);
+}
+
+int I2CMuxChannel::smbus(int addr, bool tenbit, char readWrite,
+		uint8_t command, int size, union i2c_smbus_data *data)
+{
+	return mux->smbus(channel, addr, tenbit, readWrite, command, size, data);
+}
+
+I2CMuxChannel::~I2CMuxChannel()
+{
+}
+
+/*
+ * Mux
+ */
+
+I2CMux::I2CMux(I2CBus *parent, int addr, int numChannels) :
+		parent(parent), muxAddr(addr), selectedMask(-1), selectByte(0)
+{
+	for (int i = 0; i < numChannels; i++)
+		channels.push_back(new I2CMuxChannel(this, i));
+}
+
+I2CBus *I2CMux::getChannel(int channel)
+{
+	if (channel < 0 || channel >= (int) channels.size())
+	{
+		iooo_error("I2CMux::getChannel() error: Channel %d does not exist.\n",
+				channel);
+		errno = EINVAL;
+		return nullptr;
+	}
+	return channels[channel];
+}
+
+int I2CMux::getSelected()
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->getLock());
+	for (size_t i = 0; i < channels.size(); i++)
+		if (selectedMask == (1 << i))
+			return i;
+	return -1;
+}
+
+int I2CMux::deselect()
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->getLock());
+	if (selectedMask == 0)
+		return 0;
+	return writeMask(0);
+}
+
+void I2CMux::invalidate()
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->getLock());
+	selectedMask = -1;
+}
+
+int I2CMux::writeMask(int mask)
+{
+	int rc;
+	selectByte = mask;
+
+	if (parent->useSMBus())
+		rc = parent->smbus(muxAddr, false, I2C_SMBUS_WRITE, selectByte,
+				I2C_SMBUS_BYTE, nullptr);
+	else
+	{
+		struct i2c_msg msg;
+		msg.addr = muxAddr;
+		msg.flags = 0;
+		msg.len = 1;
+		msg.buf = &selectByte;
+		rc = parent->transfer(&msg, 1);
+	}
+
+	if (rc < 0)
+	{
+		int err = errno;
+		iooo_error("I2CMux::writeMask() error: Unable to select 0x%x on mux 0x%x: %s (%d)\n",
+				mask, muxAddr, strerror(err), err);
+		selectedMask = -1;
+		errno = err;
+		return -1;
+	}
+
+	selectedMask = mask;
+	return 0;
+}
+
+int I2CMux::transfer(int channel, struct i2c_msg *msgs, int num)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->getLock());
+	int mask = 1 << channel;
+
+	if (selectedMask == mask)
+		return parent->transfer(msgs, num);
+
+	// The mux switches channels at a stop condition, so the select can
+	// only share the ioctl if the adapter can put a stop after it
+	bool fold = false;
+#ifdef I2C_FUNC_PROTOCOL_MANGLING
+	fold = (parent->getFuncs() & I2C_FUNC_PROTOCOL_MANGLING)
+			&& !parent->useSMBus() && num < I2C_RDWR_IOCTL_MAX_MSGS;
+#endif
+	if (!fold)
+	{
+		if (writeMask(mask) < 0)
+			return -1;
+		return parent->transfer(msgs, num);
+	}
+
+	selectByte = mask;
+	batch[0].addr = muxAddr;
+	batch[0].flags = I2C_M_STOP;
+	batch[0].len = 1;
+	batch[0].buf = &selectByte;
+	memcpy(batch + 1, msgs, num * sizeof(struct i2c_msg));
+
+	iooo_debug(4, "I2CMux::transfer(): selecting channel %d of mux 0x%x\n",
+			channel, muxAddr);
+	if (parent->transfer(batch, num + 1) < 0)
+	{
+		// Whether the select went through is not known
+		selectedMask = -1;
+		return -1;
+	}
+	selectedMask = mask;
+
+	// Lengths of I2C_M_RECV_LEN reads are updated by the adapter
+	for (int i = 0; i < num; i++)
+		msgs[i].len = batch[i + 1].len;
+	return num;
+}
+
+int I2CMux::smbus(int channel, int addr, bool tenbit, char readWrite,
+		uint8_t command, int size, union i2c_smbus_data *data)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->getLock());
+	int mask = 1 << channel;
+
+	if (selectedMask != mask && writeMask(mask) < 0)
+		return -1;
+	return parent->smbus(addr, tenbit, readWrite, command, size, data);
+}
+
+I2CMux::~I2CMux()
+{
+	for (I2CMuxChannel *c : channels)
+		delete c;
+}
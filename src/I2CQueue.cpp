@@ -0,0 +1,171 @@
+/*
+ * I2CQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "I2CQueue.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+I2CQueue::I2CQueue(I2CBus *bus) :
+		bus(bus)
+{
+	running = true;
+	batch.reserve(I2C_RDWR_IOCTL_MAX_MSGS);
+}
+
+I2CQueue::~I2CQueue()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = false;
+	}
+	wakeup.notify_one();
+	if (worker.joinable())
+		worker.join();
+}
+
+void I2CQueue::start()
+{
+	worker = std::thread(&I2CQueue::run, this);
+}
+
+void I2CQueue::submit(Request *req)
+{
+	std::call_once(started, &I2CQueue::start, this);
+
+	// Worker only sleeps when the queue is empty, so waking it up is needed
+	// only when this is the first request on the queue.
+	if (queue.push(req))
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		wakeup.notify_one();
+	}
+}
+
+void I2CQueue::run()
+{
+	for (;;)
+	{
+		for (Request *req = queue.popAll(); req != nullptr;)
+		{
+			Request *next = req->next;
+			pending.push_back(req);
+			req = next;
+		}
+
+		if (pending.empty())
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			if (!running && queue.empty())
+				break;
+			if (queue.empty())
+				wakeup.wait(guard);
+			continue;
+		}
+
+		// Higher priority first, submission order within a priority
+		std::stable_sort(pending.begin(), pending.end(),
+				[](const Request *a, const Request *b)
+				{
+					return a->priority > b->priority;
+				});
+
+		bool forceStop = false;
+#ifdef I2C_FUNC_PROTOCOL_MANGLING
+		forceStop = bus->getFuncs() & I2C_FUNC_PROTOCOL_MANGLING;
+#endif
+
+		// Pack as many transactions as fit into one ioctl. A failure can
+		// only be told apart per ioctl, so other clients join only if all
+		// transactions in it allow sharing.
+		size_t n = 1;
+		size_t msgs = pending[0]->msgs.size();
+		bool single = true;
+		bool shared = pending[0]->shared;
+		while (n < pending.size()
+				&& msgs + pending[n]->msgs.size() <= I2C_RDWR_IOCTL_MAX_MSGS
+				&& (forceStop || (pending[n - 1]->msgs.back().flags & I2C_M_RD)))
+		{
+			bool same = single && pending[n]->client == pending[0]->client;
+			if (!same && !(shared && pending[n]->shared))
+				break;
+			single = same;
+			shared = shared && pending[n]->shared;
+			msgs += pending[n]->msgs.size();
+			n++;
+		}
+
+		iooo_debug(3,
+				"I2CQueue::run(): executing %d transactions, %d messages\n",
+				(int ) n, (int ) msgs);
+		execute(&pending[0], n);
+		pending.erase(pending.begin(), pending.begin() + n);
+	}
+}
+
+void I2CQueue::execute(Request **reqs, int num)
+{
+	// Transactions before the failing message have been executed, so the
+	// batch is not repeated
+	int r = transfer(reqs, num);
+	if (r < 0)
+	{
+		iooo_debug(2, "I2CQueue::execute(): batch of %d failed: %s (%d)\n",
+				num, strerror(-r), -r);
+		for (int i = 1; i < num; i++)
+			if (reqs[i]->client != reqs[0]->client)
+			{
+				r = -ECANCELED;
+				break;
+			}
+	}
+
+	for (int i = 0; i < num; i++)
+		complete(reqs[i], r < 0 ? r : reqs[i]->len);
+}
+
+int I2CQueue::transfer(Request **reqs, int num)
+{
+	batch.clear();
+	for (int i = 0; i < num; i++)
+	{
+		batch.insert(batch.end(), reqs[i]->msgs.begin(), reqs[i]->msgs.end());
+#ifdef I2C_FUNC_PROTOCOL_MANGLING
+		// Stop between transactions, as separate ioctls would
+		if (i < num - 1 && (bus->getFuncs() & I2C_FUNC_PROTOCOL_MANGLING))
+			batch.back().flags |= I2C_M_STOP;
+#endif
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(bus->getLock());
+	if (bus->transfer(&batch[0], batch.size()) < 0)
+		return -errno;
+	return 0;
+}
+
+void I2CQueue::complete(Request *req, int result)
+{
+	// Reads of LSB_first devices are swapped as in I2C::endTransaction()
+	if (result >= 0 && req->swapReads)
+		for (struct i2c_msg &msg : req->msgs)
+			if (msg.flags & I2C_M_RD)
+				std::reverse(msg.buf, msg.buf + msg.len);
+
+	I2C *client = req->client;
+	if (req->callback)
+		req->callback(result);
+	else
+		req->promise.set_value(result);
+	delete req;
+
+	// Notify under the lock, so flush() cannot return and the client be
+	// destroyed before the notification is done
+	std::lock_guard<std::mutex> guard(client->pendingLock);
+	if (--client->pending == 0)
+		client->idle.notify_all();
+}
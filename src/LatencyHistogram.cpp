@@ -0,0 +1,87 @@
+/*
+ * LatencyHistogram.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "LatencyHistogram.h"
+
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram()
+{
+	clear();
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns)
+{
+	if (ns < 16)
+		return ns;
+
+	int exp = 63 - __builtin_clzll(ns);
+	if (exp >= MaxExponent)
+		return Buckets - 1;
+	int sub = (ns >> (exp - 3)) & (SubBuckets - 1);
+	return 16 + (exp - 4) * SubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::upperBound(int bucket)
+{
+	if (bucket < 16)
+		return bucket;
+
+	int exp = (bucket - 16) / SubBuckets + 4;
+	int sub = (bucket - 16) % SubBuckets;
+	return ((uint64_t) (SubBuckets + sub + 1) << (exp - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+	counts[bucketOf(ns)]++;
+	count++;
+	sum += ns;
+	if (ns < min)
+		min = ns;
+	if (ns > max)
+		max = ns;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+	for (int i = 0; i < Buckets; i++)
+		counts[i] += other.counts[i];
+	count += other.count;
+	sum += other.sum;
+	if (other.min < min)
+		min = other.min;
+	if (other.max > max)
+		max = other.max;
+}
+
+void LatencyHistogram::clear()
+{
+	memset(counts, 0, sizeof(counts));
+	count = 0;
+	sum = 0;
+	min = UINT64_MAX;
+	max = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+	if (count == 0)
+		return 0;
+
+	uint64_t rank = fraction * count;
+	if (rank >= count)
+		rank = count - 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < Buckets; i++)
+	{
+		seen += counts[i];
+		if (seen > rank)
+			return upperBound(i) < max ? upperBound(i) : max;
+	}
+	return max;
+}
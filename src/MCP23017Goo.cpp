@@ -0,0 +1,159 @@
+/*
+ * MCP23017Goo.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/MCP23017Goo.h"
+#include "debug.h"
+
+#include <string.h>
+
+// IOCON bits
+#define MCP23017_IOCON_MIRROR 0x40
+
+MCP23017Goo::MCP23017Goo(I2C *i2c, GPIOpin *intPin, int intBit) :
+		VirtualGoo(16)
+{
+	this->i2c = i2c;
+	this->intPin = intPin;
+	this->intBit = intBit;
+	iodir = 0xFFFF;
+	olat = 0;
+	gppu = 0;
+	pullups = 0;
+	synced = false;
+	stale = true;
+
+	if (intPin != nullptr)
+	{
+		// One interrupt line for both ports, raised when any input differs
+		// from its last read value
+		uint8_t iocon[2] =
+		{ RegIOCON, MCP23017_IOCON_MIRROR };
+		uint8_t gpinten[3] =
+		{ RegGPINTEN, 0xFF, 0xFF };
+		uint8_t intcon[3] =
+		{ RegINTCON, 0x00, 0x00 };
+		if (i2c->beginTransaction() < 0 || i2c->write(iocon, sizeof(iocon)) < 0
+				|| i2c->write(gpinten, sizeof(gpinten)) < 0
+				|| i2c->write(intcon, sizeof(intcon)) < 0
+				|| i2c->endTransaction() < 0)
+		{
+			iooo_error(
+					"MCP23017Goo::MCP23017Goo() error: unable to configure interrupts\n");
+			i2c->abortTransaction(false);
+		}
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	dirty = true;
+	if (flush() < 0)
+		iooo_error("MCP23017Goo::MCP23017Goo() error: unable to initialize\n");
+}
+
+MCP23017Goo::~MCP23017Goo()
+{
+	stopPeriodic();
+}
+
+int MCP23017Goo::findLine(const char *name)
+{
+	if (strncmp(name, "GP", 2) != 0)
+		return -1;
+	if ((name[2] != 'A' && name[2] != 'B') || name[3] < '0' || name[3] > '7'
+			|| name[4] != 0)
+		return -1;
+	return (name[2] - 'A') * 8 + (name[3] - '0');
+}
+
+int MCP23017Goo::update(bool write, bool read)
+{
+	uint16_t dir = iodir;
+	uint16_t out = olat;
+	int n = 0;
+
+	if (write || !synced)
+	{
+		// IODIR has 1 for inputs
+		dir = ~(directions[0] | (directions[1] << 8));
+		out = outputs[0] | (outputs[1] << 8);
+
+		// Register order matters: pull-ups and latches are set before a
+		// line turns into an output
+		const uint8_t regs[3] =
+		{ RegGPPU, RegOLAT, RegIODIR };
+		const uint16_t values[3] =
+		{ pullups, out, dir };
+		const uint16_t cached[3] =
+		{ gppu, olat, iodir };
+		for (int i = 0; i < 3; i++)
+		{
+			if (synced && values[i] == cached[i])
+				continue;
+			wbuf[n][0] = regs[i];
+			wbuf[n][1] = values[i] & 0xFF;
+			wbuf[n][2] = values[i] >> 8;
+			n++;
+		}
+	}
+
+	// Without a pending interrupt the inputs have not changed since the
+	// last read. Writes may change what output lines read back.
+	if (read && !stale && n == 0 && intPin != nullptr
+			&& (intPin->read() & (1 << intBit)) != 0)
+		read = false;
+
+	if (n == 0 && !read)
+		return 1;
+
+	uint8_t gpio = RegGPIO;
+	if (i2c->beginTransaction(false) < 0)
+		return -1;
+	bool ok = true;
+	for (int i = 0; ok && i < n; i++)
+		ok = i2c->write(wbuf[i], 3) >= 0;
+	if (!ok || (read && i2c->writeRead(&gpio, 1, rbuf, 2) < 0)
+			|| i2c->endTransaction() < 0)
+	{
+		iooo_error("MCP23017Goo::update() error: transfer failed\n");
+		i2c->abortTransaction(false);
+		// Registers may or may not have been written
+		synced = false;
+		stale = true;
+		return -1;
+	}
+
+	gppu = pullups;
+	olat = out;
+	iodir = dir;
+	synced = true;
+
+	if (read)
+	{
+		inputs[0] = rbuf[0];
+		inputs[1] = rbuf[1];
+		stale = false;
+	}
+	else if (n > 0)
+		stale = true;
+	return 1;
+}
+
+int MCP23017Goo::setPullup(const char *name, bool enable)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	int line = findLine(name);
+	if (line < 0)
+	{
+		iooo_error("MCP23017Goo::setPullup() error: no line %s\n", name);
+		return -1;
+	}
+
+	if (enable)
+		pullups |= 1 << line;
+	else
+		pullups &= ~(1 << line);
+	changed();
+	return 1;
+}
@@ -0,0 +1,305 @@
+/*
+ * MPU6050.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/MPU6050.h"
+#include "debug.h"
+#include "monotonic.h"
+
+#include <errno.h>
+#include <string.h>
+
+// PWR_MGMT_1 bits
+#define MPU6050_DEVICE_RESET 0x80
+#define MPU6050_CLKSEL_PLL_XGYRO 0x01
+
+// USER_CTRL bits
+#define MPU6050_FIFO_EN 0x40
+#define MPU6050_FIFO_RESET 0x04
+
+// INT_PIN_CFG and INT_ENABLE/INT_STATUS bits
+#define MPU6050_LATCH_INT_EN 0x20
+#define MPU6050_FIFO_OFLOW_INT 0x10
+#define MPU6050_DATA_RDY_INT 0x01
+
+/*
+ * Longest read message; adapters with a smaller limit can lower it.
+ * A drain uses at most MPU6050_MAX_CHUNKS messages of this size.
+ */
+#ifndef MPU6050_MAX_BURST
+#define MPU6050_MAX_BURST 1024
+#endif
+
+// Read chunks that fit in one I2C_RDWR ioctl with the count and status reads
+#define MPU6050_MAX_CHUNKS ((I2C_RDWR_IOCTL_MAX_MSGS - 4) / 2)
+
+// Interval of interrupt line polls in wait(), in us
+#ifndef MPU6050_INT_POLL
+#define MPU6050_INT_POLL 100
+#endif
+
+MPU6050::MPU6050(I2C *i2c, GPIOpin *intPin, int intBit) :
+		i2c(i2c), intPin(intPin), intBit(intBit), whoAmI(0), fifoSize(1024), channels(
+				0), frameSize(0), rate(0), status(0), fifoCount(0), countValid(
+				false), overflows(0)
+{
+	memset(countBuf, 0, sizeof(countBuf));
+}
+
+MPU6050::~MPU6050()
+{
+}
+
+int MPU6050::init()
+{
+	uint8_t id;
+	if (i2c->readRegister(RegWhoAmI, &id, 1) < 0)
+		return -1;
+	switch (id)
+	{
+	case WhoAmIMPU6050:
+		fifoSize = 1024;
+		break;
+	case WhoAmIMPU6500:
+	case WhoAmIMPU9250:
+		fifoSize = 512;
+		break;
+	case WhoAmIICM20602:
+		fifoSize = 1008;
+		break;
+	default:
+		iooo_error("MPU6050::init() error: Unknown chip ID 0x%02x.\n", id);
+		errno = ENODEV;
+		return -1;
+	}
+	whoAmI = id;
+
+	uint8_t reset = MPU6050_DEVICE_RESET;
+	if (i2c->writeRegister(RegPwrMgmt1, &reset, 1) < 0)
+		return -1;
+	sleepUntil(monotonicNow() + 100000000ull);
+
+	uint8_t wake = MPU6050_CLKSEL_PLL_XGYRO;
+	if (i2c->writeRegister(RegPwrMgmt1, &wake, 1) < 0)
+		return -1;
+
+	countValid = false;
+	iooo_debug(2, "MPU6050::init(): chip 0x%02x, %u byte FIFO\n", whoAmI,
+			(unsigned int) fifoSize);
+	return 0;
+}
+
+int MPU6050::configure(uint32_t rate, AccelRange accel, GyroRange gyro,
+		Dlpf dlpf, int channels)
+{
+	uint32_t base = dlpf == dlpf260Hz ? 8000 : 1000;
+	channels &= fifoAccel | fifoTemp | fifoGyro;
+	if (rate == 0 || rate > base || channels == 0)
+	{
+		iooo_error("MPU6050::configure() error: Invalid rate %u or channels 0x%x.\n",
+				rate, channels);
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint32_t div = base / rate - 1;
+	if (div > 255)
+		div = 255;
+
+	uint8_t rates[4] =
+	{ (uint8_t) div, (uint8_t) dlpf, (uint8_t) (gyro << 3), (uint8_t) (accel
+			<< 3) };
+	uint8_t fifoEn = channels;
+	uint8_t ints[2] =
+	{ MPU6050_LATCH_INT_EN, (uint8_t) (
+			intPin != nullptr ? MPU6050_DATA_RDY_INT | MPU6050_FIFO_OFLOW_INT : 0) };
+
+	if (i2c->beginTransaction() < 0
+			|| i2c->writeRegister(RegSmplrtDiv, rates, sizeof(rates)) < 0
+			|| i2c->writeRegister(RegFifoEn, &fifoEn, 1) < 0
+			|| i2c->writeRegister(RegIntPinCfg, ints, sizeof(ints)) < 0
+			|| i2c->endTransaction() < 0)
+	{
+		iooo_error("MPU6050::configure() error: Unable to write configuration.\n");
+		i2c->abortTransaction(false);
+		return -1;
+	}
+
+	this->rate = base / (div + 1);
+	this->channels = channels;
+	frameSize = ((channels & fifoAccel) ? 6 : 0) + ((channels & fifoTemp) ? 2 : 0)
+			+ ((channels & fifoGyro) ? 6 : 0);
+	raw.resize(fifoSize / 2);
+	return resetFifo();
+}
+
+int MPU6050::resetFifo()
+{
+	// The reset only works with the FIFO disabled; reading the status
+	// clears the overflow flag and the latched interrupt
+	uint8_t disable = MPU6050_FIFO_RESET;
+	uint8_t enable = MPU6050_FIFO_EN;
+	countValid = false;
+	if (i2c->beginTransaction() < 0
+			|| i2c->writeRegister(RegUserCtrl, &disable, 1) < 0
+			|| i2c->writeRegister(RegUserCtrl, &enable, 1) < 0
+			|| i2c->readRegister(RegIntStatus, &status, 1) < 0
+			|| i2c->endTransaction() < 0)
+	{
+		iooo_error("MPU6050::resetFifo() error: Unable to reset the FIFO.\n");
+		i2c->abortTransaction(false);
+		return -1;
+	}
+	fifoCount = 0;
+	status = 0;
+	countValid = true;
+	return 0;
+}
+
+int MPU6050::readState()
+{
+	uint8_t count = RegFifoCountH;
+	uint8_t stat = RegIntStatus;
+	if (i2c->beginTransaction() < 0
+			|| i2c->writeRead(&count, 1, countBuf, sizeof(countBuf)) < 0
+			|| i2c->writeRead(&stat, 1, &status, 1) < 0
+			|| i2c->endTransaction() < 0)
+	{
+		i2c->abortTransaction(false);
+		return -1;
+	}
+	fifoCount = (countBuf[0] << 8) | countBuf[1];
+	countValid = true;
+	return 0;
+}
+
+int MPU6050::wait(uint32_t timeout)
+{
+	uint64_t deadline = monotonicNow() + timeout * 1000ull;
+
+	if (intPin == nullptr)
+	{
+		uint64_t period = 1000000000ull / (rate ? rate : 1);
+		uint64_t t = monotonicNow() + period;
+		sleepUntil(t < deadline ? t : deadline);
+		return t <= deadline ? 1 : 0;
+	}
+
+	while (!(intPin->read() & (1 << intBit)))
+	{
+		uint64_t t = monotonicNow();
+		if (t >= deadline)
+			return 0;
+		t += MPU6050_INT_POLL * 1000ull;
+		sleepUntil(t < deadline ? t : deadline);
+	}
+	return 1;
+}
+
+int MPU6050::drain(Samples &samples)
+{
+	samples.count = 0;
+	if (frameSize == 0)
+	{
+		iooo_error("MPU6050::drain() error: FIFO is not configured.\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	// The count from the last drain saves a transaction when it
+	// already shows data
+	if ((!countValid || fifoCount < (size_t) frameSize) && readState() < 0)
+		return -1;
+
+	size_t frames = 0;
+	if (!(status & MPU6050_FIFO_OFLOW_INT) && fifoCount < fifoSize
+			&& fifoCount >= (size_t) frameSize)
+	{
+		frames = fifoCount / frameSize;
+		size_t maxFrames = MPU6050_MAX_CHUNKS * MPU6050_MAX_BURST / frameSize;
+		if (frames > maxFrames)
+			frames = maxFrames;
+
+		// The data, and the count and status for the next call, in one
+		// transaction; the FIFO register does not auto-increment
+		size_t bytes = frames * frameSize;
+		uint8_t *buf = (uint8_t *) raw.data();
+		uint8_t fifo = RegFifoRW;
+		uint8_t count = RegFifoCountH;
+		uint8_t stat = RegIntStatus;
+		bool ok = i2c->beginTransaction() >= 0;
+		for (size_t off = 0; ok && off < bytes; off += MPU6050_MAX_BURST)
+		{
+			size_t len = bytes - off;
+			if (len > MPU6050_MAX_BURST)
+				len = MPU6050_MAX_BURST;
+			ok = i2c->writeRead(&fifo, 1, buf + off, len) >= 0;
+		}
+		if (!ok || i2c->writeRead(&count, 1, countBuf, sizeof(countBuf)) < 0
+				|| i2c->writeRead(&stat, 1, &status, 1) < 0
+				|| i2c->endTransaction() < 0)
+		{
+			i2c->abortTransaction(false);
+			countValid = false;
+			return -1;
+		}
+		fifoCount = (countBuf[0] << 8) | countBuf[1];
+	}
+
+	if ((status & MPU6050_FIFO_OFLOW_INT) || fifoCount >= fifoSize)
+	{
+		// Frames were overwritten, so what was read may be misaligned
+		overflows++;
+		iooo_error("MPU6050::drain() error: FIFO overflow, data discarded.\n");
+		if (resetFifo() < 0)
+			return -1;
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	unpack(samples, frames);
+	return frames;
+}
+
+void MPU6050::unpack(Samples &samples, size_t frames)
+{
+	size_t words = frames * frameSize / 2;
+	uint16_t *w = raw.data();
+
+	// One pass over the whole block, which the compiler can vectorize
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (size_t i = 0; i < words; i++)
+		w[i] = __builtin_bswap16(w[i]);
+#endif
+
+	std::vector<int16_t> *dst[7];
+	int n = 0;
+	if (channels & fifoAccel)
+	{
+		dst[n++] = &samples.accel[0];
+		dst[n++] = &samples.accel[1];
+		dst[n++] = &samples.accel[2];
+	}
+	if (channels & fifoTemp)
+		dst[n++] = &samples.temperature;
+	if (channels & fifoGyro)
+	{
+		dst[n++] = &samples.gyro[0];
+		dst[n++] = &samples.gyro[1];
+		dst[n++] = &samples.gyro[2];
+	}
+
+	size_t capacity = fifoSize / frameSize;
+	for (int c = 0; c < n; c++)
+	{
+		if (dst[c]->size() < capacity)
+			dst[c]->resize(capacity);
+		int16_t *out = dst[c]->data();
+		const uint16_t *in = w + c;
+		for (size_t i = 0; i < frames; i++)
+			out[i] = (int16_t) in[i * n];
+	}
+	samples.count = frames;
+}
@@ -0,0 +1,106 @@
+/*
+ * PCF8574Goo.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/PCF8574Goo.h"
+#include "debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+PCF8574Goo::PCF8574Goo(I2C *i2c, int lines, GPIOpin *intPin, int intBit) :
+		VirtualGoo(lines > 8 ? 16 : 8)
+{
+	this->i2c = i2c;
+	this->intPin = intPin;
+	this->intBit = intBit;
+	bytes = numLines / 8;
+	port = 0xFFFF;
+	synced = false;
+	stale = true;
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	dirty = true;
+	if (flush() < 0)
+		iooo_error("PCF8574Goo::PCF8574Goo() error: unable to initialize\n");
+}
+
+PCF8574Goo::~PCF8574Goo()
+{
+	stopPeriodic();
+}
+
+int PCF8574Goo::findLine(const char *name)
+{
+	if (name[0] != 'P')
+		return -1;
+
+	char *end;
+	long i = strtol(name + 1, &end, 10);
+	if (end == name + 1 || *end != 0 || i < 0 || i >= numLines)
+		return -1;
+	return i;
+}
+
+int PCF8574Goo::update(bool write, bool read)
+{
+	uint16_t value = port;
+	bool send = false;
+
+	if (write || !synced)
+	{
+		// Inputs are released high so the device can pull them down
+		uint16_t dir = directions[0];
+		uint16_t out = outputs[0];
+		if (bytes > 1)
+		{
+			dir |= directions[1] << 8;
+			out |= outputs[1] << 8;
+		}
+		value = (out & dir) | ~dir;
+		if (bytes == 1)
+			value &= 0xFF;
+		send = !synced || value != port;
+	}
+
+	// Without a pending interrupt the port has not changed since the last
+	// read
+	if (read && !stale && !send && intPin != nullptr
+			&& (intPin->read() & (1 << intBit)) != 0)
+		read = false;
+
+	if (!send && !read)
+		return 1;
+
+	// P0-P7 first
+	wbuf[0] = value & 0xFF;
+	wbuf[1] = value >> 8;
+
+	if (i2c->beginTransaction(false) < 0)
+		return -1;
+	if ((send && i2c->write(wbuf, bytes) < 0)
+			|| (read && i2c->read(rbuf, bytes) < 0)
+			|| i2c->endTransaction() < 0)
+	{
+		iooo_error("PCF8574Goo::update() error: transfer failed\n");
+		i2c->abortTransaction(false);
+		synced = false;
+		stale = true;
+		return -1;
+	}
+
+	port = value;
+	synced = true;
+
+	if (read)
+	{
+		for (int i = 0; i < bytes; i++)
+			inputs[i] = rbuf[i];
+		stale = false;
+	}
+	else if (send)
+		stale = true;
+	return 1;
+}
@@ -0,0 +1,397 @@
+/*
+ * RegMap.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "RegMap.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <string.h>
+
+RegMap::RegMap(unsigned int numRegs, int valueBytes) :
+		numRegs(numRegs), maxBurst(0), cacheOnly(false)
+{
+	this->valueBytes = (valueBytes == 2 || valueBytes == 4) ? valueBytes : 1;
+	cache.assign(numRegs, 0);
+	flags.assign(numRegs, 0);
+	image.assign(numRegs * this->valueBytes, 0);
+	readBuf.assign(numRegs * this->valueBytes, 0);
+	runs.reserve(numRegs);
+}
+
+RegMap::~RegMap()
+{
+}
+
+void RegMap::encode(uint8_t *buf, uint32_t value)
+{
+	for (int i = 0; i < valueBytes; i++)
+		buf[i] = value >> ((valueBytes - 1 - i) * 8);
+}
+
+uint32_t RegMap::decode(const uint8_t *buf)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < valueBytes; i++)
+		value = (value << 8) | buf[i];
+	return value;
+}
+
+bool RegMap::checkRange(unsigned int reg, unsigned int num)
+{
+	if (num == 0 || reg >= numRegs || num > numRegs - reg)
+	{
+		iooo_error("RegMap: registers 0x%x+%u out of range\n", reg, num);
+		return false;
+	}
+	return true;
+}
+
+int RegMap::setVolatile(unsigned int first, unsigned int last,
+		bool isVolatile)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (last < first || !checkRange(first, last - first + 1))
+		return -EINVAL;
+
+	for (unsigned int reg = first; reg <= last; reg++)
+	{
+		if (isVolatile)
+			flags[reg] = flagVolatile;
+		else
+			flags[reg] &= ~flagVolatile;
+	}
+	return 0;
+}
+
+bool RegMap::isVolatile(unsigned int reg)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	return reg < numRegs && (flags[reg] & flagVolatile);
+}
+
+int RegMap::setDefaults(unsigned int reg, const uint32_t *values,
+		unsigned int num)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!checkRange(reg, num))
+		return -EINVAL;
+
+	for (unsigned int i = 0; i < num; i++)
+	{
+		if (flags[reg + i] & flagVolatile)
+			continue;
+		cache[reg + i] = values[i];
+		flags[reg + i] = flagValid;
+	}
+	return 0;
+}
+
+void RegMap::setMaxBurst(unsigned int regs)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	maxBurst = regs;
+}
+
+int RegMap::setCacheOnly(bool enable)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	cacheOnly = enable;
+	return enable ? 0 : sync();
+}
+
+int RegMap::read(unsigned int reg, uint32_t &value)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!checkRange(reg, 1))
+		return -EINVAL;
+
+	if ((flags[reg] & (flagValid | flagVolatile)) == flagValid)
+	{
+		value = cache[reg];
+		return 0;
+	}
+
+	uint8_t buf[4];
+	int r = readRaw(reg, buf, valueBytes);
+	if (r < 0)
+		return r;
+
+	value = decode(buf);
+	if (!(flags[reg] & flagVolatile))
+	{
+		cache[reg] = value;
+		flags[reg] |= flagValid;
+	}
+	return 0;
+}
+
+int RegMap::readBulk(unsigned int reg, uint32_t *values, unsigned int num)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!checkRange(reg, num))
+		return -EINVAL;
+
+	bool cached = true;
+	for (unsigned int i = 0; i < num && cached; i++)
+		cached = (flags[reg + i] & (flagValid | flagVolatile)) == flagValid;
+
+	if (!cached)
+	{
+		unsigned int burst = maxBurst > 0 ? maxBurst : num;
+		for (unsigned int i = 0; i < num; i += burst)
+		{
+			unsigned int n = num - i < burst ? num - i : burst;
+			int r = readRaw(reg + i, &readBuf[i * valueBytes],
+					n * valueBytes);
+			if (r < 0)
+				return r;
+		}
+	}
+
+	for (unsigned int i = 0; i < num; i++)
+	{
+		uint8_t &f = flags[reg + i];
+		// Cached values win over the device while a write is pending
+		if (cached || (f & flagDirty))
+		{
+			values[i] = cache[reg + i];
+			continue;
+		}
+
+		values[i] = decode(&readBuf[i * valueBytes]);
+		if (!(f & flagVolatile))
+		{
+			cache[reg + i] = values[i];
+			f |= flagValid;
+		}
+	}
+	return 0;
+}
+
+int RegMap::writeThrough(unsigned int reg, uint32_t value)
+{
+	uint8_t buf[4];
+	encode(buf, value);
+
+	Run run;
+	run.reg = reg;
+	run.data = buf;
+	run.len = valueBytes;
+	return writeRaw(&run, 1);
+}
+
+int RegMap::write(unsigned int reg, uint32_t value)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!checkRange(reg, 1))
+		return -EINVAL;
+
+	if (flags[reg] & flagVolatile)
+		return writeThrough(reg, value);
+
+	if ((flags[reg] & flagValid) && cache[reg] == value)
+		return 0;
+
+	cache[reg] = value;
+	flags[reg] |= flagValid | flagDirty;
+	return cacheOnly ? 0 : sync();
+}
+
+int RegMap::writeBulk(unsigned int reg, const uint32_t *values,
+		unsigned int num)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if (!checkRange(reg, num))
+		return -EINVAL;
+
+	for (unsigned int i = 0; i < num; i++)
+	{
+		uint8_t &f = flags[reg + i];
+		if (f & flagVolatile)
+		{
+			int r = writeThrough(reg + i, values[i]);
+			if (r < 0)
+				return r;
+			continue;
+		}
+		if ((f & flagValid) && cache[reg + i] == values[i])
+			continue;
+
+		cache[reg + i] = values[i];
+		f |= flagValid | flagDirty;
+	}
+	return cacheOnly ? 0 : sync();
+}
+
+int RegMap::updateBits(unsigned int reg, uint32_t mask, uint32_t value,
+		bool *changed)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	uint32_t old;
+	int r = read(reg, old);
+	if (r < 0)
+		return r;
+
+	uint32_t v = (old & ~mask) | (value & mask);
+	if (changed != nullptr)
+		*changed = v != old;
+	if (v == old)
+		return 0;
+	return write(reg, v);
+}
+
+int RegMap::sync()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	// One burst per run of dirty registers
+	runs.clear();
+	unsigned int reg = 0;
+	while (reg < numRegs)
+	{
+		if (!(flags[reg] & flagDirty))
+		{
+			reg++;
+			continue;
+		}
+
+		unsigned int first = reg;
+		while (reg < numRegs && (flags[reg] & flagDirty)
+				&& (maxBurst == 0 || reg - first < maxBurst))
+		{
+			encode(&image[reg * valueBytes], cache[reg]);
+			reg++;
+		}
+
+		Run run;
+		run.reg = first;
+		run.data = &image[first * valueBytes];
+		run.len = (reg - first) * valueBytes;
+		runs.push_back(run);
+	}
+
+	if (runs.empty())
+		return 0;
+
+	int r = writeRaw(&runs[0], runs.size());
+	if (r < 0)
+		return r;
+
+	for (const Run &run : runs)
+		for (unsigned int i = 0; i < run.len / valueBytes; i++)
+			flags[run.reg + i] &= ~flagDirty;
+	return 0;
+}
+
+void RegMap::markDirty()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	for (uint8_t &f : flags)
+		if (f == flagValid)
+			f |= flagDirty;
+}
+
+void RegMap::invalidate()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	for (uint8_t &f : flags)
+		f &= flagVolatile;
+}
+
+I2CRegMap::I2CRegMap(I2C *i2c, unsigned int numRegs, int valueBytes) :
+		RegMap(numRegs > 256 ? 256 : numRegs, valueBytes), i2c(i2c)
+{
+}
+
+I2CRegMap::~I2CRegMap()
+{
+}
+
+int I2CRegMap::readRaw(unsigned int reg, uint8_t *buf, size_t len)
+{
+	if (i2c->readRegister(reg, buf, len) < 0)
+		return -errno;
+	return 0;
+}
+
+int I2CRegMap::writeRaw(const Run *runs, int num)
+{
+	// A run may take two messages with I2C_M_NOSTART. SMBus adapters take
+	// one run at a time.
+	int perTransaction = I2C_RDWR_IOCTL_MAX_MSGS / 2;
+	I2CBus *bus = i2c->getBus();
+	if (bus != nullptr && bus->useSMBus())
+		perTransaction = 1;
+
+	for (int i = 0; i < num;)
+	{
+		int n = num - i < perTransaction ? num - i : perTransaction;
+		if (n == 1)
+		{
+			if (i2c->writeRegister(runs[i].reg, runs[i].data, runs[i].len) < 0)
+				return -errno;
+			i++;
+			continue;
+		}
+
+		if (i2c->beginTransaction() < 0)
+			return -errno;
+		for (int k = 0; k < n; k++)
+		{
+			const Run &run = runs[i + k];
+			if (i2c->writeRegister(run.reg, run.data, run.len) < 0)
+			{
+				int err = errno;
+				i2c->abortTransaction(false);
+				return -err;
+			}
+		}
+		if (i2c->endTransaction() < 0)
+			return -errno;
+		i += n;
+	}
+	return 0;
+}
+
+SPIRegMap::SPIRegMap(SPI *spi, unsigned int numRegs, int valueBytes,
+		uint8_t readFlag, uint8_t writeFlag, uint8_t burstFlag) :
+		RegMap(numRegs, valueBytes), spi(spi), readFlag(readFlag), writeFlag(
+				writeFlag), burstFlag(burstFlag)
+{
+	headers.assign(numRegs, 0);
+	segs.reserve(2 * numRegs);
+}
+
+SPIRegMap::~SPIRegMap()
+{
+}
+
+int SPIRegMap::readRaw(unsigned int reg, uint8_t *buf, size_t len)
+{
+	uint8_t hdr = reg | readFlag | (len > 1 ? burstFlag : 0);
+	SPI::Segment s[2] =
+	{ SPI::Segment(&hdr, nullptr, 1), SPI::Segment(nullptr, buf, len) };
+	int r = spi->xfer(s, 2);
+	return r < 0 ? r : 0;
+}
+
+int SPIRegMap::writeRaw(const Run *runs, int num)
+{
+	// All bursts in one message, chip select toggled between them
+	segs.clear();
+	for (int i = 0; i < num; i++)
+	{
+		headers[i] = runs[i].reg | writeFlag
+				| (runs[i].len > 1 ? burstFlag : 0);
+		segs.push_back(SPI::Segment(&headers[i], nullptr, 1));
+		segs.push_back(SPI::Segment(runs[i].data, nullptr, runs[i].len));
+		segs.back().cs_change = i < num - 1;
+	}
+
+	int r = spi->xfer(&segs[0], segs.size());
+	return r < 0 ? r : 0;
+}
@@ -6,102 +6,176 @@
  */
 
 #include "SPI.h"
+#include "SPIQueue.h"
+#include "SPITransport.h"
 #include "debug.h"
 
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <sys/ioctl.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 
-#define MAX_PATH_LEN  40
-#define SPI_DEVICE_PATH_BASE "/dev/spidev"
+#include <type_traits>
+#include <utility>
 
-#define KERNEL_BUS(bus) bus
-#ifdef _HW_PLATFORM_BEAGLEBONE
-#ifdef _KERNEL_VERSION
-// SPIDEV1 and SPIDEV2 are switched in BeagleBone kernel 4.x, but not 3.x
-#undef KERNEL_BUS
-#define KERNEL_MAJ_VER _KERNEL_VERSION[0]
-#define KERNEL_BUS(bus) KERNEL_MAJ_VER == '4' ? (bus == 2 ? 1 : (bus == 1 ? 2 : bus)) : bus
-#endif
-#endif
+/*
+ * spi_ioc_transfer got the word_delay_usecs field in kernel 5.x, without a
+ * macro to test for it, so the field is looked up by the compiler
+ */
+template<typename T, typename = void>
+struct HasWordDelay: std::false_type
+{
+};
+
+template<typename T>
+struct HasWordDelay<T, decltype((void) std::declval<T>().word_delay_usecs)> : std::true_type
+{
+};
+
+template<typename T>
+static void setWordDelay(T &t, uint8_t delay, std::true_type)
+{
+	t.word_delay_usecs = delay;
+}
 
-std::map<int, std::map<int, SPI::SharedResources>> SPI::share;
+template<typename T>
+static void setWordDelay(T &, uint8_t, std::false_type)
+{
+}
 
-SPI::SPI()
+SPI::SPI() :
+		pending(0)
 {
 	active_bus = -1;
 	active_channel = -1;
-	mode = 0;
-	bpw = 0;
-	speed = 0;
-	fd = -1;
-	lsb_first = false;
+	transport = nullptr;
 	resources = nullptr;
 }
 
-int SPI::open(int bus, int channel)
+SPI::SharedResources *SPI::getResources(int bus, int channel)
 {
-	// Check for valid bus and channel
-	if (bus < 0 || channel < 0)
-		return -ENODEV;
+	// Built once, on first use. After that lookups are plain indexing and
+	// need no locking.
+	static SharedResources registry[SPI_MAX_BUSES][SPI_MAX_CHANNELS];
 
-	// Obtain locking and chip select resources
-	SharedResources *resources_tmp = &share[bus][channel];
-	std::lock_guard<std::recursive_mutex> lock(resources_tmp->rwlock);
+	if (bus < 0 || bus >= SPI_MAX_BUSES || channel < 0
+			|| channel >= SPI_MAX_CHANNELS)
+		return nullptr;
 
-	// If a device is already open, close it before continuing further
-	if (active_bus >= 0)
-		close();
+	return &registry[bus][channel];
+}
 
-	iooo_debug(3, "SPI::open(): bus=%d, channel=%d\n", bus, channel);
+int SPI::openDevice(int bus, int channel, SharedResources *res)
+{
+	int r;
+	if (res->transport == nullptr)
+	{
+		SPIDevTransport *dev = new SPIDevTransport();
+		if ((r = dev->open(bus, channel)) < 0)
+		{
+			delete dev;
+			return r;
+		}
+		res->transport = dev;
+	}
 
-	char path[MAX_PATH_LEN];
-	if (snprintf(path, MAX_PATH_LEN, "%s%d.%d", SPI_DEVICE_PATH_BASE, KERNEL_BUS(bus),
-			channel) >= MAX_PATH_LEN)
-		return -EINVAL;
+	if ((r = res->transport->getSettings(res->defaults)) < 0)
+	{
+		closeDevice(res);
+		return r;
+	}
+
+	// Whatever was read back is what the device is programmed with now
+	res->mode = res->defaults.mode;
+	res->lsb_first = res->defaults.lsb_first;
+	res->bufsiz = res->transport->getMaxMessageSize();
+	return 1;
+}
 
-	if ((fd = ::open(path, O_RDWR, 0)) < 0)
+int SPI::closeDevice(SharedResources *res)
+{
+	// Attached transports stay with the channel until detached
+	if (!res->attached)
 	{
-		iooo_error("open(%s) failed\n", path);
-		return fd;
+		delete res->transport;
+		res->transport = nullptr;
 	}
+	return 0;
+}
 
-	uint8_t tmp;
-	uint32_t tmp32;
-	int r;
-	if ((r = ioctl(fd, SPI_IOC_RD_MODE, &tmp)) < 0)
+int SPI::attach(int bus, int channel, SPITransport *transport)
+{
+	SharedResources *res = getResources(bus, channel);
+	if (res == nullptr || transport == nullptr)
+		return -ENODEV;
+
+	std::lock_guard<std::recursive_mutex> lock(res->rwlock);
+	if (res->users > 0)
 	{
-		iooo_error("ioctl(fd, SPI_IOC_RD_MODE, &tmp) failed\n");
-		return r;
+		iooo_error("SPI::attach(): bus %d, channel %d is in use\n", bus, channel);
+		return -EBUSY;
 	}
-	mode = tmp;
+	if (res->attached || res->transport != nullptr)
+		return -EBUSY;
+
+	res->transport = transport;
+	res->attached = true;
+	return 1;
+}
 
-	if ((r = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &tmp)) < 0)
+int SPI::detach(int bus, int channel)
+{
+	SharedResources *res = getResources(bus, channel);
+	if (res == nullptr)
+		return -ENODEV;
+
+	std::lock_guard<std::recursive_mutex> lock(res->rwlock);
+	if (res->users > 0)
 	{
-		iooo_error("ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &tmp) failed\n");
-		return r;
+		iooo_error("SPI::detach(): bus %d, channel %d is in use\n", bus, channel);
+		return -EBUSY;
 	}
-	bpw = tmp;
+	if (!res->attached)
+		return -ENODEV;
+
+	res->transport = nullptr;
+	res->attached = false;
+	return 1;
+}
+
+int SPI::open(int bus, int channel)
+{
+	// Check for valid bus and channel
+	if (bus < 0 || channel < 0)
+		return -ENODEV;
 
-	if ((r = ioctl(fd, SPI_IOC_RD_LSB_FIRST, &tmp)) < 0)
+	// Obtain locking and chip select resources
+	SharedResources *resources_tmp = getResources(bus, channel);
+	if (resources_tmp == nullptr)
 	{
-		iooo_error("ioctl(fd, SPI_IOC_WR_LSB_FIRST, &tmp) failed\n");
-		return r;
+		iooo_error("SPI::open(): bus %d, channel %d out of range\n", bus, channel);
+		return -ENODEV;
 	}
-	this->lsb_first = lsb_first;
+	std::lock_guard<std::recursive_mutex> lock(resources_tmp->rwlock);
 
-	if ((r = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &tmp32)) < 0)
+	// If a device is already open, close it before continuing further
+	if (active_bus >= 0)
+		close();
+
+	iooo_debug(3, "SPI::open(): bus=%d, channel=%d\n", bus, channel);
+
+	// All clients of a channel share one transport
+	if (resources_tmp->users == 0)
 	{
-		iooo_error("ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &tmp) failed\n");
-		return r;
+		int r = openDevice(bus, channel, resources_tmp);
+		if (r < 0)
+			return r;
 	}
-	speed = tmp32;
+	resources_tmp->users++;
 
+	transport = resources_tmp->transport;
+	profile = resources_tmp->defaults;
 	active_bus = bus;
 	active_channel = channel;
 	resources = resources_tmp;
@@ -116,6 +190,9 @@ int SPI::close()
 		iooo_error("SPI::close(): failed - no device has been opened\n");
 		return -EDESTADDRREQ;
 	}
+	// Queued transfers still refer to the device
+	flush();
+
 	// Mutex lock on this bus and channel
 	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
 
@@ -126,14 +203,16 @@ int SPI::close()
 	}
 
 	iooo_debug(3, "SPI::close()\n");
-	mode = 0;
-	bpw = 0;
-	speed = 0;
+	SharedResources *res = resources;
+	profile = Profile();
 	active_bus = active_channel = -1;
 	resources = nullptr;
-	int tmpfd = fd;
-	fd = -1;
-	return ::close(tmpfd);
+	transport = nullptr;
+
+	// Last client of the channel closes the device
+	if (--res->users > 0)
+		return 0;
+	return closeDevice(res);
 }
 
 int SPI::chipSelect(GPIOpin* pin, int bit, int polarity)
@@ -230,18 +309,44 @@ int SPI::setMode(uint8_t mode)
 	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
 
 	mode &= SPI_CPHA | SPI_CPOL;
-	mode = (this->mode & ~(SPI_CPHA | SPI_CPOL)) | mode;
+	return setModeFlags((profile.mode & ~(SPI_CPHA | SPI_CPOL)) | mode);
+}
 
-	int r = ioctl(fd, SPI_IOC_WR_MODE, &mode);
-	if (r < 0)
-		return r;
+int SPI::setModeFlags(uint32_t mode)
+{
+	if (resources == nullptr)
+	{
+		iooo_error("SPI::setModeFlags(): failed - no device has been opened\n");
+		return -EDESTADDRREQ;
+	}
 
-	r = ioctl(fd, SPI_IOC_RD_MODE, &mode);
-	if (r < 0)
-		return r;
+	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
+
+	// Program the device right away only if it is not already in this mode,
+	// so that an unsupported mode is reported here and not by every transfer.
+	if (resources->mode != mode)
+	{
+		int r = writeMode(mode);
+		if (r < 0)
+			return r;
+	}
+
+	profile.mode = mode;
+
+	return 1;
+}
 
-	this->mode = mode;
+uint32_t SPI::getModeFlags()
+{
+	return profile.mode;
+}
 
+int SPI::writeMode(uint32_t mode)
+{
+	int r = transport->setMode(mode);
+	if (r < 0)
+		return r;
+	resources->mode = mode;
 	return 1;
 }
 
@@ -256,7 +361,7 @@ int SPI::setClockPolarity(uint8_t pol)
 	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
 
 	pol &= SPI_CPOL;
-	uint8_t mode = (this->mode & ~(SPI_CPOL)) | pol;
+	uint8_t mode = (profile.mode & SPI_CPHA) | pol;
 	return setMode(mode);
 }
 
@@ -271,7 +376,7 @@ int SPI::setClockPhase(uint8_t phase)
 	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
 
 	phase &= SPI_CPHA;
-	uint8_t mode = (this->mode & ~(SPI_CPHA)) | phase;
+	uint8_t mode = (profile.mode & SPI_CPOL) | phase;
 	return setMode(mode);
 }
 
@@ -287,10 +392,14 @@ int SPI::setLSBFirst(bool lsb_first)
 
 	if (!isReady())
 		return -ENODEV;
-	int r;
-	if ((r = ioctl(fd, SPI_IOC_WR_LSB_FIRST, &lsb_first)) < 0)
-		return r;
-	this->lsb_first = lsb_first;
+	if (resources->lsb_first != lsb_first)
+	{
+		int r;
+		if ((r = transport->setLSBFirst(lsb_first)) < 0)
+			return r;
+		resources->lsb_first = lsb_first;
+	}
+	profile.lsb_first = lsb_first;
 	return 1;
 }
 
@@ -302,14 +411,13 @@ int SPI::setBitsPerWord(int bits)
 		return -EDESTADDRREQ;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
-
 	if (!isReady())
 		return -ENODEV;
-	int r;
-	if ((r = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)) < 0)
-		return r;
-	bpw = bits;
+	if (bits <= 0 || bits > 32)
+		return -EINVAL;
+
+	// Word size is passed with every transfer, no need to program the device
+	profile.bpw = bits;
 	return 1;
 }
 
@@ -321,87 +429,371 @@ int SPI::setSpeed(uint32_t speed)
 		return -EDESTADDRREQ;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
-
-	int r;
 	if (!isReady())
 		return -ENODEV;
-	r = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-	if (r < 0)
-	{
-		iooo_error("ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed): %s", strerror(r));
-		return r;
-	}
+	if (speed == 0)
+		return -EINVAL;
 
-	uint32_t tmp;
-	r = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &tmp);
-	if (r < 0)
-	{
-		iooo_error("ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed): %s", strerror(r));
-		return r;
-	}
-	this->speed = tmp;
+	// Speed is passed with every transfer, no need to program the device
+	profile.speed = speed;
 	return 1;
+}
 
+SPI::Profile SPI::getProfile()
+{
+	return profile;
 }
 
-int SPI::write(const void *wbuf, int len)
+uint32_t SPI::getMaxMessageSize()
+{
+	return resources != nullptr ? resources->bufsiz : 0;
+}
+
+int SPI::setProfile(const Profile &profile)
 {
 	if (resources == nullptr)
 	{
-		iooo_error("SPI::write(): failed - no device has been opened\n");
+		iooo_error("SPI::setProfile(): failed - no device has been opened\n");
 		return -EDESTADDRREQ;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
+	if (profile.bpw <= 0 || profile.bpw > 32 || profile.speed == 0)
+		return -EINVAL;
+
+	this->profile = profile;
+	return 1;
+}
 
-	return ::write(fd, wbuf, len);
+int SPI::write(const void *wbuf, int len)
+{
+	return xfer1(wbuf, NULL, len);
 }
 
 int SPI::read(void *rbuf, int len)
+{
+	if (len > 0)
+		memset(rbuf, 0, len);
+	return xfer1(NULL, rbuf, len);
+}
+
+int SPI::xfer1(const void *wbuf, void *rbuf, int len)
+{
+	// A negative length would become a huge segment length
+	if (len <= 0)
+		return -EINVAL;
+
+	Segment seg(wbuf, rbuf, len);
+
+	int r = xfer(&seg, 1);
+	if (r < 0)
+		return r;
+
+	return len;
+}
+
+int SPI::xfer(const Segment *segs, int num)
 {
 	if (resources == nullptr)
 	{
-		iooo_error("SPI::read(): failed - no device has been opened\n");
+		iooo_error("SPI::xfer(): failed - no device has been opened\n");
 		return -EDESTADDRREQ;
 	}
 
+	int r = checkSegments(segs, num);
+	if (r < 0)
+		return r;
+
 	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
 
-	memset(rbuf, 0, len);
-	return ::read(fd, rbuf, len);
+	r = applyConfig();
+	if (r < 0)
+		return r;
+
+	return transfer(segs, num);
 }
 
-int SPI::xfer1(const void *wbuf, void *rbuf, int len)
+int SPI::checkSegments(const Segment *segs, int num)
 {
-	if (resources == nullptr)
+	if (segs == nullptr || num <= 0)
+		return -EINVAL;
+
+	// The segments are split by length, and the total is returned as int
+	uint64_t total = 0;
+	for (int i = 0; i < num; i++)
 	{
-		iooo_error("SPI::xfer1(): failed - no device has been opened\n");
-		return -EDESTADDRREQ;
+		total += segs[i].len;
+		// Sending without the delay would give a different waveform
+		if (segs[i].word_delay != 0
+				&& !HasWordDelay<struct spi_ioc_transfer>::value)
+			return -EOPNOTSUPP;
 	}
+	if (total > INT32_MAX)
+		return -EINVAL;
+	return 0;
+}
 
-	std::lock_guard<std::recursive_mutex> lock(resources->rwlock);
+int SPI::transfer(const Segment *segs, int num)
+{
+	struct spi_ioc_transfer txinfo[MaxMessageSegments];
+	const uint32_t bufsiz = resources->bufsiz;
+	int total = 0;
+	int i = 0;
+	uint32_t offset = 0; // Part of segs[i] already sent
+
+	while (i < num)
+	{
+		// Fill one message with up to bufsiz bytes, splitting segments if needed
+		int n = 0;
+		uint32_t bytes = 0;
+		while (i < num && n < MaxMessageSegments)
+		{
+			const Segment &seg = segs[i];
+			uint8_t bpw = seg.bpw ? seg.bpw : profile.bpw;
+			// Words take 1, 2 or 4 bytes in buffers; never split inside a word
+			uint32_t wordsize = bpw > 16 ? 4 : bpw > 8 ? 2 : 1;
+
+			uint32_t len = seg.len - offset;
+			if (len > bufsiz - bytes)
+				len = (bufsiz - bytes) / wordsize * wordsize;
+			if (len == 0 && seg.len != 0)
+				break;
+
+			struct spi_ioc_transfer &t = txinfo[n];
+			memset(&t, 0, sizeof(t));
+			t.tx_buf = seg.wbuf ? (__u64 ) ((const uint8_t *) seg.wbuf + offset) : 0;
+			t.rx_buf = seg.rbuf ? (__u64 ) ((uint8_t *) seg.rbuf + offset) : 0;
+			t.len = len;
+			t.speed_hz = seg.speed ? seg.speed : profile.speed;
+			t.bits_per_word = bpw;
+#ifdef SPI_IOC_WR_MODE32
+			// Came with the 32-bit mode in kernel 3.15
+			t.tx_nbits = seg.tx_nbits;
+			t.rx_nbits = seg.rx_nbits;
+#endif
+			setWordDelay(t, seg.word_delay,
+					HasWordDelay<struct spi_ioc_transfer>());
+			n++;
+			bytes += len;
+
+			offset += len;
+			if (offset < seg.len)
+				break;
+			// Delay and chip select change belong after the last piece only
+			t.delay_usecs = seg.delay_usecs;
+			t.cs_change = seg.cs_change;
+			offset = 0;
+			i++;
+		}
+
+		if (n == 0)
+			return -EMSGSIZE;
+
+		// cs_change on the last transfer of a message asks the kernel to keep
+		// the chip selected. Keep it selected across a split, unless the caller
+		// wanted it released there anyway.
+		if (i < num)
+			txinfo[n - 1].cs_change = !txinfo[n - 1].cs_change;
+		else
+			txinfo[n - 1].cs_change = 0;
+
+		int r = transport->message(txinfo, n);
+		if (r < 0)
+			return r;
+
+		total += bytes;
+	}
+
+	return total;
+}
+
+int SPI::applyConfig()
+{
+	return applyConfig(profile);
+}
+
+int SPI::applyConfig(const Profile &profile)
+{
+	if (!isReady())
+		return -ENODEV;
+
+	// Only mode and bit order are device-wide settings. Speed and word size
+	// go with each transfer.
+	int r;
+	if (resources->mode != profile.mode)
+	{
+		if ((r = writeMode(profile.mode)) < 0)
+			return r;
+	}
 
-	struct spi_ioc_transfer txinfo;
-	txinfo.tx_buf = (__u64 ) wbuf;
-	txinfo.rx_buf = (__u64 ) rbuf;
-	txinfo.len = len;
-	txinfo.delay_usecs = 0;
-	txinfo.speed_hz = speed;
-	txinfo.bits_per_word = bpw;
-	txinfo.cs_change = 0;
+	if (resources->lsb_first != profile.lsb_first)
+	{
+		if ((r = transport->setLSBFirst(profile.lsb_first)) < 0)
+			return r;
+		resources->lsb_first = profile.lsb_first;
+	}
+
+	return 1;
+}
+
+/*
+ * Asynchronous transfers
+ */
 
-	int r = ioctl(fd, SPI_IOC_MESSAGE(1), &txinfo);
+std::future<int> SPI::submit(const Segment *segs, int num, int priority)
+{
+	std::future<int> result;
+
+	int r = queueRequest(segs, num, priority, std::function<void(int)>(),
+			&result);
 	if (r < 0)
 	{
-		iooo_error("ioctl(fd, SPI_IOC_MESSAGE(1), &txinfo): %s (len=%d)\n",
-				strerror(r), len);
+		std::promise<int> failed;
+		failed.set_value(r);
+		return failed.get_future();
+	}
+	return result;
+}
+
+int SPI::submit(const Segment *segs, int num, std::function<void(int)> callback,
+		int priority)
+{
+	return queueRequest(segs, num, priority, callback, nullptr);
+}
+
+int SPI::queueRequest(const Segment *segs, int num, int priority,
+		std::function<void(int)> callback, std::future<int> *result)
+{
+	if (resources == nullptr)
+	{
+		iooo_error("SPI::submit(): failed - no device has been opened\n");
+		return -EDESTADDRREQ;
+	}
+
+	int r = checkSegments(segs, num);
+	if (r < 0)
 		return r;
+
+	SPIQueue *queue = SPIQueue::getQueue(active_bus);
+	if (queue == nullptr)
+		return -ENODEV;
+
+	SPIQueue::Request *req = new SPIQueue::Request;
+	req->client = this;
+	req->priority = priority;
+	req->profile = profile;
+	req->segs.assign(segs, segs + num);
+	req->len = 0;
+	for (int i = 0; i < num; i++)
+	{
+		// Freeze speed and word size of the client at submission time
+		if (req->segs[i].speed == 0)
+			req->segs[i].speed = profile.speed;
+		if (req->segs[i].bpw == 0)
+			req->segs[i].bpw = profile.bpw;
+		req->len += segs[i].len;
+	}
+	req->callback = callback;
+	if (result != nullptr)
+		*result = req->promise.get_future();
+
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		pending++;
+	}
+	queue->submit(req);
+	return 1;
+}
+
+void SPI::flush()
+{
+	std::unique_lock<std::mutex> guard(pendingLock);
+	idle.wait(guard, [this]
+	{	return pending == 0;});
+}
+
+/*
+ * Sessions
+ */
+
+SPI::Session::Session(SPI &spi) :
+		spi(&spi), selected(false), status(1)
+{
+	if (spi.resources == nullptr)
+	{
+		iooo_error("SPI::Session::Session(): failed - no device has been opened\n");
+		status = -EDESTADDRREQ;
+		return;
 	}
 
+	lock = std::unique_lock<std::recursive_mutex>(spi.resources->rwlock);
+	status = spi.applyConfig();
+}
+
+SPI::Session::Session(SPI &spi, GPIOpin *pin, int bit, int polarity) :
+		Session(spi)
+{
+	if (status < 0)
+		return;
+
+	status = spi.chipSelect(pin, bit, polarity);
+	selected = status >= 0;
+}
+
+SPI::Session::~Session()
+{
+	if (selected)
+		spi->chipDeselect();
+}
+
+bool SPI::Session::isReady()
+{
+	return status >= 0;
+}
+
+int SPI::Session::getStatus()
+{
+	return status;
+}
+
+int SPI::Session::write(const void *wbuf, int len)
+{
+	return xfer1(wbuf, NULL, len);
+}
+
+int SPI::Session::read(void *rbuf, int len)
+{
+	if (len > 0)
+		memset(rbuf, 0, len);
+	return xfer1(NULL, rbuf, len);
+}
+
+int SPI::Session::xfer1(const void *wbuf, void *rbuf, int len)
+{
+	// A negative length would become a huge segment length
+	if (len <= 0)
+		return -EINVAL;
+
+	Segment seg(wbuf, rbuf, len);
+
+	int r = xfer(&seg, 1);
+	if (r < 0)
+		return r;
+
 	return len;
 }
 
+int SPI::Session::xfer(const Segment *segs, int num)
+{
+	if (status < 0)
+		return status;
+
+	int r = checkSegments(segs, num);
+	if (r < 0)
+		return r;
+
+	return spi->transfer(segs, num);
+}
+
 SPI::~SPI()
 {
 	iooo_debug(4, "SPI::~SPI()\n");
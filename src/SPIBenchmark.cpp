@@ -0,0 +1,273 @@
+/*
+ * SPIBenchmark.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPIBenchmark.h"
+#include "SPIBuffer.h"
+#include "debug.h"
+
+#include <errno.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*
+ * Forwards everything to the measured transport and counts the calls that
+ * would be ioctls on spidev. Calls are serialized by the channel lock.
+ */
+class SPIBenchmark::CountingTransport: public SPITransport
+{
+	public:
+		SPITransport *backend;
+		uint64_t ioctls;
+
+		CountingTransport(SPITransport *backend) :
+				backend(backend), ioctls(0)
+		{
+		}
+		;
+
+		virtual int getSettings(SPI::Profile &settings)
+		{
+			return backend->getSettings(settings);
+		}
+		;
+
+		virtual int setMode(uint32_t mode)
+		{
+			ioctls++;
+			return backend->setMode(mode);
+		}
+		;
+
+		virtual int setLSBFirst(bool lsb_first)
+		{
+			ioctls++;
+			return backend->setLSBFirst(lsb_first);
+		}
+		;
+
+		virtual int message(struct spi_ioc_transfer *xfers, int num)
+		{
+			ioctls++;
+			return backend->message(xfers, num);
+		}
+		;
+
+		virtual uint32_t getMaxMessageSize()
+		{
+			return backend->getMaxMessageSize();
+		}
+		;
+};
+
+SPIBenchmark::SPIBenchmark()
+{
+	bus = -1;
+	channel = -1;
+	device = nullptr;
+	counter = nullptr;
+	cspin = nullptr;
+	csbit = 0;
+	cspol = 0;
+}
+
+SPIBenchmark::~SPIBenchmark()
+{
+	if (counter != nullptr)
+		close();
+}
+
+int SPIBenchmark::open(int bus, int channel, SPITransport *backend)
+{
+	if (counter != nullptr)
+		close();
+
+	int r;
+	if (backend == nullptr)
+	{
+		device = new SPIDevTransport();
+		if ((r = device->open(bus, channel)) < 0)
+		{
+			delete device;
+			device = nullptr;
+			return r;
+		}
+		backend = device;
+	}
+
+	counter = new CountingTransport(backend);
+	if ((r = SPI::attach(bus, channel, counter)) < 0)
+	{
+		iooo_error("SPIBenchmark::open(): can not take over bus %d, channel %d\n",
+				bus, channel);
+		close();
+		return r;
+	}
+
+	this->bus = bus;
+	this->channel = channel;
+	return 1;
+}
+
+int SPIBenchmark::close()
+{
+	int r = 1;
+	if (bus >= 0)
+		r = SPI::detach(bus, channel);
+	bus = channel = -1;
+
+	delete counter;
+	counter = nullptr;
+	delete device;
+	device = nullptr;
+	return r;
+}
+
+void SPIBenchmark::setChipSelect(GPIOpin *pin, int bit, int polarity)
+{
+	cspin = pin;
+	csbit = bit;
+	cspol = polarity;
+}
+
+void SPIBenchmark::worker(const Case &test, std::shared_future<void> start,
+		LatencyHistogram *latency, int *errors)
+{
+	SPI spi;
+	SPIBuffer wbuf(test.size);
+	SPIBuffer rbuf(test.size);
+	if (spi.open(bus, channel) < 0 || spi.setSpeed(test.speed) < 0
+			|| spi.setBitsPerWord(test.bpw) < 0 || wbuf.data() == nullptr
+			|| rbuf.data() == nullptr)
+	{
+		*errors = test.iterations;
+		start.wait();
+		return;
+	}
+
+	for (uint32_t i = 0; i < test.size; i++)
+		wbuf.data()[i] = i * 37 + 11;
+
+	// Pieces are whole words, the last one takes the remainder
+	uint32_t wordsize = test.bpw > 16 ? 4 : test.bpw > 8 ? 2 : 1;
+	uint32_t words = test.size / wordsize;
+	uint32_t num = test.segments > 1 ? test.segments : 1;
+	if (num > words)
+		num = words > 0 ? words : 1;
+	std::vector<SPI::Segment> segs(num);
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < num; i++)
+	{
+		uint32_t len = i < num - 1 ? words / num * wordsize : test.size - offset;
+		segs[i] = SPI::Segment(wbuf.data() + offset, rbuf.data() + offset, len);
+		offset += len;
+	}
+
+	start.wait();
+	for (int it = 0; it < test.iterations; it++)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		int r = 1;
+		if (cspin != nullptr)
+		{
+			SPI::Session session(spi, cspin, csbit, cspol);
+			if (num == 1)
+				r = session.xfer1(wbuf.data(), rbuf.data(), test.size);
+			else if (test.batched)
+				r = session.xfer(&segs[0], num);
+			else
+				for (uint32_t i = 0; i < num && r >= 0; i++)
+					r = session.xfer1(segs[i].wbuf, segs[i].rbuf, segs[i].len);
+		}
+		else
+		{
+			if (num == 1)
+				r = spi.xfer1(wbuf.data(), rbuf.data(), test.size);
+			else if (test.batched)
+				r = spi.xfer(&segs[0], num);
+			else
+				for (uint32_t i = 0; i < num && r >= 0; i++)
+					r = spi.xfer1(segs[i].wbuf, segs[i].rbuf, segs[i].len);
+		}
+		auto t1 = std::chrono::steady_clock::now();
+
+		if (r < 0)
+			(*errors)++;
+		else
+			latency->record(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+	}
+}
+
+int SPIBenchmark::run(const Case &test, Result &result)
+{
+	if (counter == nullptr)
+	{
+		iooo_error("SPIBenchmark::run(): no channel has been opened\n");
+		return -EDESTADDRREQ;
+	}
+	if (test.size == 0 || test.threads < 1 || test.iterations < 1)
+		return -EINVAL;
+
+	std::vector<LatencyHistogram> latency(test.threads);
+	std::vector<int> errors(test.threads, 0);
+	std::vector<std::thread> threads;
+	std::promise<void> go;
+	std::shared_future<void> start = go.get_future().share();
+
+	for (int i = 0; i < test.threads; i++)
+		threads.push_back(
+				std::thread(&SPIBenchmark::worker, this, test, start, &latency[i],
+						&errors[i]));
+
+	// Let the workers open their clients before the clock starts
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	uint64_t ioctls = counter->ioctls;
+	auto t0 = std::chrono::steady_clock::now();
+	go.set_value();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	auto t1 = std::chrono::steady_clock::now();
+
+	result.test = test;
+	result.latency.clear();
+	result.errors = 0;
+	for (int i = 0; i < test.threads; i++)
+	{
+		result.latency.merge(latency[i]);
+		result.errors += errors[i];
+	}
+	result.operations = result.latency.getCount();
+	result.bytes = result.operations * test.size;
+	result.ioctls = counter->ioctls - ioctls;
+	result.seconds = std::chrono::duration<double>(t1 - t0).count();
+	result.bytesPerSecond = result.seconds > 0 ? result.bytes / result.seconds : 0;
+	result.ioctlsPerSecond =
+			result.seconds > 0 ? result.ioctls / result.seconds : 0;
+	return result.errors ? -EIO : 1;
+}
+
+void SPIBenchmark::printHeader(FILE *f)
+{
+	fprintf(f, "%8s %9s %3s %4s %5s %3s %8s %12s %10s %9s %9s %9s %9s %6s\n",
+			"size", "speed", "bpw", "segs", "batch", "thr", "ops", "bytes/s",
+			"ioctls/s", "p50[us]", "p99[us]", "p999[us]", "max[us]", "errors");
+}
+
+void SPIBenchmark::print(FILE *f, const Result &result)
+{
+	const Case &t = result.test;
+	fprintf(f,
+			"%8u %9u %3u %4d %5s %3d %8llu %12.0f %10.0f %9.1f %9.1f %9.1f %9.1f %6d\n",
+			t.size, t.speed, t.bpw, t.segments, t.batched ? "yes" : "no",
+			t.threads, (unsigned long long) result.operations,
+			result.bytesPerSecond, result.ioctlsPerSecond,
+			result.latency.percentile(0.5) / 1000.0,
+			result.latency.percentile(0.99) / 1000.0,
+			result.latency.percentile(0.999) / 1000.0,
+			result.latency.getMax() / 1000.0, result.errors);
+}
@@ -0,0 +1,150 @@
+/*
+ * SPIBuffer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPIBuffer.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <mutex>
+
+// Size classes are 1, 2, 4 ... MaxPooledPages pages
+#define SIZE_CLASSES 9
+static_assert(((size_t) 1 << (SIZE_CLASSES - 1)) == SPIBuffer::MaxPooledPages,
+		"size classes must cover MaxPooledPages");
+
+static struct
+{
+	std::mutex lock;
+	void *free[SIZE_CLASSES][SPI_BUFFER_POOL_DEPTH];
+	int count[SIZE_CLASSES];
+} pool;
+
+static size_t pageSize()
+{
+	static const size_t size = sysconf(_SC_PAGESIZE) > 0 ?
+			sysconf(_SC_PAGESIZE) : 4096;
+	return size;
+}
+
+SPIBuffer::SPIBuffer() :
+		buf(nullptr), len(0), sizeClass(-1)
+{
+}
+
+SPIBuffer::SPIBuffer(size_t len) :
+		buf(nullptr), len(0), sizeClass(-1)
+{
+	allocate(len);
+}
+
+SPIBuffer::SPIBuffer(SPIBuffer &&other) :
+		buf(other.buf), len(other.len), sizeClass(other.sizeClass)
+{
+	other.buf = nullptr;
+	other.len = 0;
+	other.sizeClass = -1;
+}
+
+SPIBuffer &SPIBuffer::operator=(SPIBuffer &&other)
+{
+	if (this != &other)
+	{
+		release();
+		buf = other.buf;
+		len = other.len;
+		sizeClass = other.sizeClass;
+		other.buf = nullptr;
+		other.len = 0;
+		other.sizeClass = -1;
+	}
+	return *this;
+}
+
+SPIBuffer::~SPIBuffer()
+{
+	release();
+}
+
+int SPIBuffer::allocate(size_t len)
+{
+	release();
+	if (len == 0)
+		return 1;
+
+	size_t pages = (len + pageSize() - 1) / pageSize();
+	int cls = 0;
+	while (cls < SIZE_CLASSES && ((size_t) 1 << cls) < pages)
+		cls++;
+
+	if (cls < SIZE_CLASSES)
+		buf = (uint8_t *) take(cls, ((size_t) 1 << cls) * pageSize());
+	else
+	{
+		cls = -1;
+		buf = (uint8_t *) take(cls, pages * pageSize());
+	}
+
+	if (buf == nullptr)
+	{
+		iooo_error("SPIBuffer::allocate(%u): out of memory\n", (unsigned ) len);
+		return -ENOMEM;
+	}
+
+	this->len = len;
+	sizeClass = cls;
+	return 1;
+}
+
+void SPIBuffer::release()
+{
+	if (buf != nullptr)
+		give(buf, sizeClass);
+	buf = nullptr;
+	len = 0;
+	sizeClass = -1;
+}
+
+void *SPIBuffer::take(int sizeClass, size_t bytes)
+{
+	if (sizeClass >= 0)
+	{
+		std::lock_guard<std::mutex> guard(pool.lock);
+		if (pool.count[sizeClass] > 0)
+			return pool.free[sizeClass][--pool.count[sizeClass]];
+	}
+
+	void *mem;
+	if (posix_memalign(&mem, pageSize(), bytes) != 0)
+		return nullptr;
+	return mem;
+}
+
+void SPIBuffer::give(void *buf, int sizeClass)
+{
+	if (sizeClass >= 0)
+	{
+		std::lock_guard<std::mutex> guard(pool.lock);
+		if (pool.count[sizeClass] < SPI_BUFFER_POOL_DEPTH)
+		{
+			pool.free[sizeClass][pool.count[sizeClass]++] = buf;
+			return;
+		}
+	}
+	free(buf);
+}
+
+void SPIBuffer::trim()
+{
+	std::lock_guard<std::mutex> guard(pool.lock);
+	for (int cls = 0; cls < SIZE_CLASSES; cls++)
+	{
+		while (pool.count[cls] > 0)
+			free(pool.free[cls][--pool.count[cls]]);
+	}
+}
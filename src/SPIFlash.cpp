@@ -0,0 +1,379 @@
+/*
+ * SPIFlash.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/SPIFlash.h"
+#include "debug.h"
+#include "monotonic.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+// Polls spin for this long before yielding the CPU between polls
+#ifndef SPIFLASH_SPIN_US
+#define SPIFLASH_SPIN_US	1000
+#endif
+
+SPIFlash::SPIFlash(SPI *spi) :
+		spi(spi), size(0), addrBytes(3), readMode(readFast)
+{
+	memset(id, 0, sizeof(id));
+}
+
+SPIFlash::~SPIFlash()
+{
+}
+
+int SPIFlash::header(uint8_t *buf, uint8_t cmd, uint32_t addr)
+{
+	int n = 0;
+	buf[n++] = cmd;
+	for (int i = addrBytes - 1; i >= 0; i--)
+		buf[n++] = addr >> (i * 8);
+	return n;
+}
+
+int SPIFlash::probe()
+{
+	// Leaves deep power-down; the part is ready after tRES1, a few us
+	uint8_t wake = CmdReleasePowerDown;
+	int r = spi->write(&wake, 1);
+	if (r < 0)
+		return r;
+	sleepUntil(monotonicNow() + 30000);
+
+	uint8_t tx[4] =
+	{ CmdJedecId, 0, 0, 0 };
+	uint8_t rx[4];
+	r = spi->xfer1(tx, rx, sizeof(tx));
+	if (r < 0)
+		return r;
+	memcpy(id, rx + 1, 3);
+
+	if ((id[0] == 0x00 && id[1] == 0x00 && id[2] == 0x00)
+			|| (id[0] == 0xFF && id[1] == 0xFF && id[2] == 0xFF))
+	{
+		iooo_error("SPIFlash::probe() error: no flash part answers\n");
+		return -ENODEV;
+	}
+
+	// The capacity byte is log2 of the size, with a jump at 512 Mbit on
+	// some parts
+	uint8_t c = id[2];
+	if (c >= 0x10 && c <= 0x1F)
+		size = 1u << c;
+	else if (c >= 0x20 && c <= 0x22)
+		size = 1u << (c - 6);
+	else
+	{
+		iooo_error("SPIFlash::probe() error: unknown capacity code 0x%02x\n",
+				c);
+		size = 0;
+		return -ENODEV;
+	}
+	iooo_debug(1, "SPIFlash::probe(): ID %02x %02x %02x, %u bytes\n", id[0],
+			id[1], id[2], size);
+
+	if (size > (1u << 24))
+	{
+		// Some parts want write enable before the mode change. Others leave
+		// WEL set, which would arm them for a stray program or erase, so
+		// the status is read back in the same message.
+		uint8_t wren = CmdWriteEnable;
+		uint8_t enter = CmdEnter4Byte;
+		uint8_t rdsr = CmdReadStatus;
+		uint8_t status = 0;
+		SPI::Segment segs[4] =
+		{ SPI::Segment(&wren, nullptr, 1), SPI::Segment(&enter, nullptr, 1),
+				SPI::Segment(&rdsr, nullptr, 1), SPI::Segment(nullptr, &status, 1) };
+		segs[0].cs_change = true;
+		segs[1].cs_change = true;
+		r = spi->xfer(segs, 4);
+		if (r < 0)
+			return r;
+		if (status & StatusWriteEnabled)
+		{
+			uint8_t wrdi = CmdWriteDisable;
+			r = spi->xfer1(&wrdi, nullptr, 1);
+			if (r < 0)
+				return r;
+		}
+		addrBytes = 4;
+	}
+	else
+		addrBytes = 3;
+
+	readMode = readFast;
+#ifdef SPI_RX_QUAD
+	uint32_t flags = spi->getModeFlags();
+	if (flags & SPI_RX_QUAD)
+		readMode = readQuad;
+	else if (flags & SPI_RX_DUAL)
+		readMode = readDual;
+#endif
+	return 1;
+}
+
+int SPIFlash::setReadMode(ReadMode mode)
+{
+	if (mode == readDual || mode == readQuad)
+	{
+#ifdef SPI_RX_QUAD
+		uint32_t flags = spi->getModeFlags();
+		if ((mode == readDual && !(flags & (SPI_RX_DUAL | SPI_RX_QUAD)))
+				|| (mode == readQuad && !(flags & SPI_RX_QUAD)))
+			return -EINVAL;
+#else
+		return -EINVAL;
+#endif
+	}
+	readMode = mode;
+	return 1;
+}
+
+int SPIFlash::read(uint32_t addr, void *buf, uint32_t len)
+{
+	if (size == 0)
+		return -ENODEV;
+	if (len > size || addr > size - len)
+		return -EINVAL;
+
+	uint8_t cmd;
+	uint8_t lines = 1;
+	switch (readMode)
+	{
+		case readNormal:
+			cmd = CmdRead;
+			break;
+		case readDual:
+			cmd = CmdDualRead;
+			lines = 2;
+			break;
+		case readQuad:
+			cmd = CmdQuadRead;
+			lines = 4;
+			break;
+		default:
+			cmd = CmdFastRead;
+			break;
+	}
+
+	// Command, address and the dummy byte of the fast reads share the
+	// message with the data
+	uint8_t hdr[6];
+	int h = header(hdr, cmd, 0) + (readMode == readNormal ? 0 : 1);
+	uint32_t max = spi->getMaxMessageSize();
+	if (max <= (uint32_t) h)
+		return -EMSGSIZE;
+	uint32_t chunk = max - h;
+
+	uint8_t *p = (uint8_t *) buf;
+	uint32_t done = 0;
+	while (done < len)
+	{
+		uint32_t n = len - done < chunk ? len - done : chunk;
+		header(hdr, cmd, addr + done);
+		if (readMode != readNormal)
+			hdr[h - 1] = 0;
+
+		SPI::Segment segs[2] =
+		{ SPI::Segment(hdr, nullptr, h), SPI::Segment(nullptr, p + done, n) };
+		segs[1].rx_nbits = lines;
+		int r = spi->xfer(segs, 2);
+		if (r < 0)
+			return r;
+		done += n;
+	}
+	return len;
+}
+
+int SPIFlash::modify(const uint8_t *hdr, int hlen, const void *data,
+		uint32_t len, uint32_t timeout)
+{
+	// Write enable, the command and the first status poll in one message
+	uint8_t wren = CmdWriteEnable;
+	uint8_t rdsr = CmdReadStatus;
+	uint8_t status = StatusBusy;
+	SPI::Segment segs[5];
+	int n = 0;
+	segs[n] = SPI::Segment(&wren, nullptr, 1);
+	segs[n++].cs_change = true;
+	segs[n++] = SPI::Segment(hdr, nullptr, hlen);
+	if (len > 0)
+		segs[n++] = SPI::Segment(data, nullptr, len);
+	segs[n - 1].cs_change = true;
+	segs[n++] = SPI::Segment(&rdsr, nullptr, 1);
+	segs[n++] = SPI::Segment(nullptr, &status, 1);
+
+	int r = spi->xfer(segs, n);
+	if (r < 0)
+		return r;
+	if (!(status & StatusBusy))
+		return 1;
+	return waitReady(timeout);
+}
+
+int SPIFlash::readStatus(uint8_t &status)
+{
+	uint8_t tx[2] =
+	{ CmdReadStatus, 0 };
+	uint8_t rx[2];
+	int r = spi->xfer1(tx, rx, 2);
+	if (r < 0)
+		return r;
+	status = rx[1];
+	return 1;
+}
+
+int SPIFlash::waitReady(uint32_t timeoutUs)
+{
+	uint64_t start = monotonicNow();
+	uint64_t deadline = start + timeoutUs * 1000ull;
+	uint64_t spinEnd = start + SPIFLASH_SPIN_US * 1000ull;
+
+	for (;;)
+	{
+		uint8_t status;
+		int r = readStatus(status);
+		if (r < 0)
+			return r;
+		if (!(status & StatusBusy))
+			return 1;
+
+		uint64_t t = monotonicNow();
+		if (t > deadline)
+		{
+			iooo_error("SPIFlash::waitReady() error: still busy after %u us\n",
+					timeoutUs);
+			return -ETIMEDOUT;
+		}
+		// Erases take long enough to let other threads run between polls
+		if (t > spinEnd)
+			sched_yield();
+	}
+}
+
+void SPIFlash::mirror(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+	for (Mapping &m : mappings)
+	{
+		uint32_t mlen = m.data.size();
+		uint32_t from = addr > m.addr ? addr : m.addr;
+		uint32_t to =
+				addr + len < m.addr + mlen ? addr + len : m.addr + mlen;
+		for (uint32_t a = from; a < to; a++)
+		{
+			// Programming can only clear bits
+			if (data == nullptr)
+				m.data[a - m.addr] = 0xFF;
+			else
+				m.data[a - m.addr] &= data[a - addr];
+		}
+	}
+}
+
+int SPIFlash::write(uint32_t addr, const void *buf, uint32_t len)
+{
+	if (size == 0)
+		return -ENODEV;
+	if (len > size || addr > size - len)
+		return -EINVAL;
+
+	const uint8_t *p = (const uint8_t *) buf;
+	uint8_t hdr[5];
+	uint32_t done = 0;
+	while (done < len)
+	{
+		// A page program wraps around within its page
+		uint32_t a = addr + done;
+		uint32_t n = PageSize - (a % PageSize);
+		if (n > len - done)
+			n = len - done;
+
+		int h = header(hdr, CmdPageProgram, a);
+		int r = modify(hdr, h, p + done, n, SPIFLASH_PROGRAM_TIMEOUT);
+		if (r < 0)
+			return r;
+		mirror(a, p + done, n);
+		done += n;
+	}
+	return len;
+}
+
+int SPIFlash::erase(uint32_t addr, uint32_t len)
+{
+	if (size == 0)
+		return -ENODEV;
+	if (len > size || addr > size - len)
+		return -EINVAL;
+	if ((addr % SectorSize) != 0 || (len % SectorSize) != 0)
+		return -EINVAL;
+
+	uint8_t hdr[5];
+	while (len > 0)
+	{
+		uint32_t n;
+		int r;
+		if ((addr % BlockSize) == 0 && len >= BlockSize)
+		{
+			n = BlockSize;
+			r = modify(hdr, header(hdr, CmdBlockErase, addr), nullptr, 0,
+			SPIFLASH_BLOCK_TIMEOUT);
+		}
+		else
+		{
+			n = SectorSize;
+			r = modify(hdr, header(hdr, CmdSectorErase, addr), nullptr, 0,
+			SPIFLASH_SECTOR_TIMEOUT);
+		}
+		if (r < 0)
+			return r;
+		mirror(addr, nullptr, n);
+		addr += n;
+		len -= n;
+	}
+	return 1;
+}
+
+int SPIFlash::eraseChip()
+{
+	if (size == 0)
+		return -ENODEV;
+
+	uint8_t cmd = CmdChipErase;
+	int r = modify(&cmd, 1, nullptr, 0, SPIFLASH_CHIP_TIMEOUT);
+	if (r < 0)
+		return r;
+	mirror(0, nullptr, size);
+	return 1;
+}
+
+const uint8_t *SPIFlash::map(uint32_t addr, uint32_t len)
+{
+	if (size == 0 || len == 0 || len > size || addr > size - len)
+		return nullptr;
+
+	mappings.emplace_back(addr, len);
+	Mapping &m = mappings.back();
+	if (read(addr, &m.data[0], len) < 0)
+	{
+		mappings.pop_back();
+		return nullptr;
+	}
+	return &m.data[0];
+}
+
+void SPIFlash::unmap(const uint8_t *view)
+{
+	for (auto i = mappings.begin(); i != mappings.end(); i++)
+	{
+		if (&i->data[0] == view)
+		{
+			mappings.erase(i);
+			return;
+		}
+	}
+}
@@ -0,0 +1,347 @@
+/*
+ * SPIModel.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPIModel.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <string.h>
+
+void SPILoopbackModel::exchange(const uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+	if (rx == nullptr)
+		return;
+	if (tx != nullptr)
+		memmove(rx, tx, len);
+	else
+		memset(rx, 0, len);
+}
+
+SPIScriptedModel::SPIScriptedModel(uint8_t fill) :
+		position(0), fill(fill)
+{
+}
+
+void SPIScriptedModel::addResponse(const void *data, size_t len)
+{
+	const uint8_t *bytes = (const uint8_t *) data;
+	responses.push_back(std::vector<uint8_t>(bytes, bytes + len));
+}
+
+void SPIScriptedModel::clear()
+{
+	responses.clear();
+	frames.clear();
+	response.clear();
+	position = 0;
+}
+
+void SPIScriptedModel::select()
+{
+	frames.push_back(std::vector<uint8_t>());
+	response.clear();
+	if (!responses.empty())
+	{
+		response.swap(responses.front());
+		responses.pop_front();
+	}
+	position = 0;
+}
+
+void SPIScriptedModel::exchange(const uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+	if (frames.empty())
+		frames.push_back(std::vector<uint8_t>());
+	std::vector<uint8_t> &frame = frames.back();
+
+	if (tx != nullptr)
+		frame.insert(frame.end(), tx, tx + len);
+	else
+		frame.resize(frame.size() + len, 0);
+
+	for (uint32_t i = 0; i < len; i++, position++)
+	{
+		if (rx != nullptr)
+			rx[i] = position < response.size() ? response[position] : fill;
+	}
+}
+
+void SPIScriptedModel::deselect()
+{
+	response.clear();
+	position = 0;
+}
+
+SPIFlashModel::SPIFlashModel(uint8_t capacity, uint8_t manufacturer,
+		uint8_t type) :
+		memory(1u << capacity, 0xFF), programPolls(2), erasePolls(10), busy(0), writeEnabled(
+				false), addrBytes(3), cmd(0), position(0), addr(0)
+{
+	id[0] = manufacturer;
+	id[1] = type;
+	id[2] = capacity;
+	memset(page, 0xFF, sizeof(page));
+	memset(pageUsed, 0, sizeof(pageUsed));
+}
+
+void SPIFlashModel::setBusyPolls(uint32_t program, uint32_t erase)
+{
+	programPolls = program;
+	erasePolls = erase;
+}
+
+int SPIFlashModel::headerLength()
+{
+	switch (cmd)
+	{
+		case 0x03: // Read
+		case 0x02: // Page program
+		case 0x20: // Sector erase
+		case 0xD8: // Block erase
+			return 1 + addrBytes;
+		case 0x0B: // Fast, dual and quad reads have a dummy byte
+		case 0x3B:
+		case 0x6B:
+			return 2 + addrBytes;
+		default:
+			return 1;
+	}
+}
+
+void SPIFlashModel::select()
+{
+	cmd = 0;
+	position = 0;
+	addr = 0;
+	memset(page, 0xFF, sizeof(page));
+	memset(pageUsed, 0, sizeof(pageUsed));
+}
+
+void SPIFlashModel::exchange(const uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+	uint32_t size = memory.size();
+	for (uint32_t i = 0; i < len; i++, position++)
+	{
+		uint8_t in = tx != nullptr ? tx[i] : 0;
+		uint8_t out = 0xFF;
+
+		if (position == 0)
+		{
+			cmd = in;
+			// Only the status can be read while busy
+			if (busy > 0 && cmd != 0x05)
+			{
+				stats.violations++;
+				cmd = 0;
+			}
+			switch (cmd)
+			{
+				case 0x06:
+					writeEnabled = true;
+					break;
+				case 0x04:
+					writeEnabled = false;
+					break;
+				case 0xB7:
+					addrBytes = 4;
+					break;
+				case 0xE9:
+					addrBytes = 3;
+					break;
+				case 0x03:
+				case 0x0B:
+				case 0x3B:
+				case 0x6B:
+					stats.reads++;
+					break;
+			}
+		}
+		else if (cmd == 0x9F)
+			out = position <= 3 ? id[position - 1] : 0xFF;
+		else if (cmd == 0x05)
+		{
+			out = (busy > 0 ? 0x01 : 0) | (writeEnabled ? 0x02 : 0);
+			stats.statusPolls++;
+			if (busy > 0 && --busy == 0)
+				writeEnabled = false;
+		}
+		else if (position <= (uint32_t) addrBytes)
+			addr = (addr << 8) | in;
+		else if (position >= (uint32_t) headerLength())
+		{
+			uint32_t n = position - headerLength();
+			switch (cmd)
+			{
+				case 0x03:
+				case 0x0B:
+				case 0x3B:
+				case 0x6B:
+					out = memory[(addr + n) % size];
+					break;
+				case 0x02:
+				{
+					// Data wraps around within the page
+					uint8_t off = (addr + n) & 0xFF;
+					page[off] = in;
+					pageUsed[off] = true;
+					break;
+				}
+			}
+		}
+
+		if (rx != nullptr)
+			rx[i] = out;
+	}
+}
+
+void SPIFlashModel::deselect()
+{
+	uint32_t size = memory.size();
+	bool modifies = cmd == 0x02 || cmd == 0x20 || cmd == 0xD8 || cmd == 0xC7;
+	if (modifies && position >= (uint32_t) headerLength())
+	{
+		if (!writeEnabled)
+			stats.violations++;
+		else
+		{
+			uint32_t base;
+			switch (cmd)
+			{
+				case 0x02:
+					base = (addr % size) & ~0xFFu;
+					for (int i = 0; i < 256; i++)
+						if (pageUsed[i])
+							memory[base + i] &= page[i];
+					stats.programs++;
+					busy = programPolls;
+					break;
+				case 0x20:
+					base = (addr % size) & ~0xFFFu;
+					memset(&memory[base], 0xFF, 0x1000);
+					stats.erases++;
+					busy = erasePolls;
+					break;
+				case 0xD8:
+					base = (addr % size) & ~0xFFFFu;
+					memset(&memory[base], 0xFF,
+							size - base < 0x10000 ? size - base : 0x10000);
+					stats.erases++;
+					busy = erasePolls;
+					break;
+				case 0xC7:
+					memset(&memory[0], 0xFF, size);
+					stats.erases++;
+					busy = erasePolls;
+					break;
+			}
+			if (busy == 0)
+				writeEnabled = false;
+		}
+	}
+	cmd = 0;
+	position = 0;
+}
+
+SPIModelTransport::SPIModelTransport(SPIDeviceModel *model,
+		const SPI::Profile &settings, uint32_t maxMessageSize) :
+		model(model), settings(settings), maxMessageSize(maxMessageSize), selected(
+				false)
+{
+}
+
+SPIModelTransport::~SPIModelTransport()
+{
+	if (selected)
+		model->deselect();
+}
+
+int SPIModelTransport::getSettings(SPI::Profile &settings)
+{
+	settings = this->settings;
+	return 1;
+}
+
+int SPIModelTransport::setMode(uint32_t mode)
+{
+	settings.mode = mode;
+	stats.setups++;
+	return 1;
+}
+
+int SPIModelTransport::setLSBFirst(bool lsb_first)
+{
+	settings.lsb_first = lsb_first;
+	stats.setups++;
+	return 1;
+}
+
+int SPIModelTransport::message(struct spi_ioc_transfer *xfers, int num)
+{
+	if (num <= 0 || num > SPI::MaxMessageSegments)
+	{
+		errno = EINVAL;
+		return -EINVAL;
+	}
+
+	uint64_t total = 0;
+	for (int i = 0; i < num; i++)
+		total += xfers[i].len;
+	if (total > maxMessageSize)
+	{
+		iooo_error("SPIModelTransport::message(): %u bytes exceed %u\n",
+				(unsigned ) total, maxMessageSize);
+		errno = EMSGSIZE;
+		return -EMSGSIZE;
+	}
+
+	stats.messages++;
+	for (int i = 0; i < num; i++)
+	{
+		const struct spi_ioc_transfer &t = xfers[i];
+
+		if (!selected)
+		{
+			model->select();
+			selected = true;
+			stats.selects++;
+		}
+
+		if (t.len > 0)
+			model->exchange((const uint8_t *) (uintptr_t) t.tx_buf,
+					(uint8_t *) (uintptr_t) t.rx_buf, t.len);
+
+		stats.transfers++;
+		stats.bytes += t.len;
+
+		uint32_t speed = t.speed_hz ? t.speed_hz : settings.speed;
+		unsigned lines = 1;
+#ifdef SPI_IOC_WR_MODE32
+		// Came with the 32-bit mode in kernel 3.15
+		lines = t.tx_nbits > t.rx_nbits ? t.tx_nbits : t.rx_nbits;
+		if (lines == 0)
+			lines = 1;
+#endif
+		if (speed > 0)
+			stats.busTime += (uint64_t) t.len * 8 * 1000000000ull / lines / speed;
+		stats.busTime += (uint64_t) t.delay_usecs * 1000;
+
+		// cs_change releases the chip between transfers, but keeps it
+		// selected after the last one
+		bool last = i == num - 1;
+		if (last != (bool) t.cs_change)
+		{
+			model->deselect();
+			selected = false;
+		}
+	}
+
+	return total;
+}
+
+uint32_t SPIModelTransport::getMaxMessageSize()
+{
+	return maxMessageSize;
+}
@@ -0,0 +1,146 @@
+/*
+ * SPIQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPIQueue.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <algorithm>
+
+SPIQueue::SPIQueue()
+{
+	running = true;
+}
+
+SPIQueue::~SPIQueue()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = false;
+	}
+	wakeup.notify_one();
+	if (worker.joinable())
+		worker.join();
+}
+
+SPIQueue *SPIQueue::getQueue(int bus)
+{
+	// Workers are started on first submission, so the table is cheap to build
+	static SPIQueue queues[SPI_MAX_BUSES];
+
+	if (bus < 0 || bus >= SPI_MAX_BUSES)
+		return nullptr;
+
+	return &queues[bus];
+}
+
+void SPIQueue::start()
+{
+	worker = std::thread(&SPIQueue::run, this);
+}
+
+void SPIQueue::submit(Request *req)
+{
+	std::call_once(started, &SPIQueue::start, this);
+
+	// Worker only sleeps when the queue is empty, so waking it up is needed
+	// only when this is the first request on the queue.
+	if (queue.push(req))
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		wakeup.notify_one();
+	}
+}
+
+void SPIQueue::run()
+{
+	for (;;)
+	{
+		for (Request *req = queue.popAll(); req != nullptr;)
+		{
+			Request *next = req->next;
+			pending.push_back(req);
+			req = next;
+		}
+
+		if (pending.empty())
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			if (!running && queue.empty())
+				break;
+			if (queue.empty())
+				wakeup.wait(guard);
+			continue;
+		}
+
+		// Higher priority first, submission order within a priority
+		std::stable_sort(pending.begin(), pending.end(),
+				[](const Request *a, const Request *b)
+				{
+					return a->priority > b->priority;
+				});
+
+		// Coalesce the run of requests from the same client
+		Request *first = pending[0];
+		size_t n = 1;
+		size_t segs = first->segs.size();
+		while (n < pending.size() && pending[n]->client == first->client
+				&& pending[n]->priority == first->priority
+				&& pending[n]->profile.mode == first->profile.mode
+				&& pending[n]->profile.lsb_first == first->profile.lsb_first
+				&& segs + pending[n]->segs.size() <= SPI::MaxMessageSegments)
+		{
+			segs += pending[n]->segs.size();
+			n++;
+		}
+
+		iooo_debug(3, "SPIQueue::run(): executing %d requests, %d segments\n",
+				(int ) n, (int ) segs);
+		int r = execute(&pending[0], n);
+		for (size_t i = 0; i < n; i++)
+			complete(pending[i], r < 0 ? r : pending[i]->len);
+		pending.erase(pending.begin(), pending.begin() + n);
+	}
+}
+
+int SPIQueue::execute(Request **reqs, int num)
+{
+	SPI *spi = reqs[0]->client;
+	if (spi->resources == nullptr)
+		return -EDESTADDRREQ;
+
+	batch.clear();
+	for (int i = 0; i < num; i++)
+	{
+		batch.insert(batch.end(), reqs[i]->segs.begin(), reqs[i]->segs.end());
+		// Release chip select between requests, as separate ioctls would
+		batch.back().cs_change = true;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(spi->resources->rwlock);
+
+	int r = spi->applyConfig(reqs[0]->profile);
+	if (r < 0)
+		return r;
+
+	return spi->transfer(&batch[0], batch.size());
+}
+
+void SPIQueue::complete(Request *req, int result)
+{
+	SPI *client = req->client;
+	if (req->callback)
+		req->callback(result);
+	else
+		req->promise.set_value(result);
+	delete req;
+
+	// Notify under the lock, so flush() cannot return and the client be
+	// destroyed before the notification is done
+	std::lock_guard<std::mutex> guard(client->pendingLock);
+	if (--client->pending == 0)
+		client->idle.notify_all();
+}
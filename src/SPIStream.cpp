@@ -0,0 +1,321 @@
+/*
+ * SPIStream.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPIStream.h"
+#include "debug.h"
+#include "monotonic.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+SPIStream::SPIStream(SPI *spi) :
+		head(0), tail(0), frames(0), overruns(0), missed(0), errors(0), running(
+				false)
+{
+	this->spi = spi;
+	frameSize = 0;
+	framesPerBlock = 0;
+	numBlocks = 0;
+	period = 0;
+	spinMargin = 0;
+	priority = 0;
+	event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+SPIStream::~SPIStream()
+{
+	stop();
+	if (event >= 0)
+		close(event);
+}
+
+int SPIStream::setTemplate(const SPI::Segment *segs, int num)
+{
+	if (running)
+		return -EBUSY;
+	if (segs == nullptr || num <= 0 || num > SPI::MaxMessageSegments)
+		return -EINVAL;
+
+	this->segs.assign(segs, segs + num);
+	frameSize = 0;
+	for (int i = 0; i < num; i++)
+		frameSize += segs[i].len;
+	scratch.resize(frameSize);
+
+	// Ring depends on the frame size
+	numBlocks = 0;
+	blocks.clear();
+	return 1;
+}
+
+int SPIStream::setBuffer(uint32_t framesPerBlock, uint32_t blocks)
+{
+	if (running)
+		return -EBUSY;
+	if (frameSize == 0)
+	{
+		iooo_error("SPIStream::setBuffer(): template has not been set\n");
+		return -EINVAL;
+	}
+	if (framesPerBlock == 0 || blocks == 0)
+		return -EINVAL;
+
+	int r = data.allocate((size_t) frameSize * framesPerBlock * blocks);
+	if (r < 0)
+		return r;
+	timestamps.assign((size_t) framesPerBlock * blocks, 0);
+
+	this->blocks.resize(blocks);
+	for (uint32_t i = 0; i < blocks; i++)
+	{
+		Block &b = this->blocks[i];
+		b.data = data.data() + (size_t) i * framesPerBlock * frameSize;
+		b.timestamps = &timestamps[(size_t) i * framesPerBlock];
+		b.frames = framesPerBlock;
+		b.frameSize = frameSize;
+		b.sequence = 0;
+	}
+	this->framesPerBlock = framesPerBlock;
+	numBlocks = blocks;
+	head = 0;
+	tail = 0;
+	return 1;
+}
+
+void SPIStream::setSpinMargin(uint32_t usecs)
+{
+	spinMargin = usecs;
+}
+
+void SPIStream::setPriority(int priority)
+{
+	this->priority = priority;
+}
+
+int SPIStream::start(uint64_t periodNs)
+{
+	if (running)
+		return -EBUSY;
+	if (numBlocks == 0)
+	{
+		iooo_error("SPIStream::start(): buffer has not been set\n");
+		return -EINVAL;
+	}
+	if (periodNs == 0 || event < 0)
+		return -EINVAL;
+
+	period = periodNs;
+	head = 0;
+	tail = 0;
+	frames = overruns = missed = errors = 0;
+	running = true;
+	worker = std::thread(&SPIStream::run, this);
+	return 1;
+}
+
+int SPIStream::stop()
+{
+	running = false;
+	if (worker.joinable())
+		worker.join();
+
+	// Wake up an application waiting in acquire()
+	uint64_t one = 1;
+	if (write(event, &one, sizeof(one)) < 0)
+	{
+		// Counter is saturated, the application is awake anyway
+	}
+	return 1;
+}
+
+uint64_t SPIStream::waitPeriod(int timer, uint64_t &deadline)
+{
+	uint64_t skipped = 0;
+	if (timer >= 0)
+	{
+		uint64_t expirations = 0;
+		if (read(timer, &expirations, sizeof(expirations)) == sizeof(expirations)
+				&& expirations > 1)
+			skipped = expirations - 1;
+		return skipped;
+	}
+
+	// Sleep until the margin, spin the rest
+	uint64_t wake = deadline - spinMargin * 1000ull;
+	if (monotonicNow() < wake)
+		sleepUntil(wake);
+	uint64_t t;
+	while ((t = monotonicNow()) < deadline)
+		;
+
+	if (t - deadline >= period)
+	{
+		skipped = (t - deadline) / period;
+		deadline += skipped * period;
+	}
+	deadline += period;
+	return skipped;
+}
+
+void SPIStream::run()
+{
+	if (priority > 0)
+	{
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		int r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (r != 0)
+			iooo_error("SPIStream: can not set real-time priority: %s\n",
+					strerror(r));
+	}
+
+	std::vector<SPI::Segment> work(segs);
+	uint64_t deadline = monotonicNow() + period;
+
+	int timer = -1;
+	if (spinMargin == 0)
+	{
+		timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		struct itimerspec spec;
+		spec.it_value = toTimespec(deadline);
+		spec.it_interval = toTimespec(period);
+		if (timer < 0
+				|| timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+		{
+			iooo_error("SPIStream: timerfd failed: %s, spinning instead\n",
+					strerror(errno));
+			if (timer >= 0)
+				close(timer);
+			timer = -1;
+		}
+	}
+
+	uint64_t block = 0;
+	uint32_t frame = 0;
+	while (running.load(std::memory_order_relaxed))
+	{
+		uint64_t skipped = waitPeriod(timer, deadline);
+		if (skipped)
+			missed.fetch_add(skipped, std::memory_order_relaxed);
+
+		// A new block may only be started when the application has released one
+		bool drop = frame == 0
+				&& block - tail.load(std::memory_order_acquire) >= numBlocks;
+		uint8_t *dst =
+				drop ? &scratch[0] :
+						data.data()
+								+ ((size_t) (block % numBlocks) * framesPerBlock
+										+ frame) * frameSize;
+		for (size_t i = 0; i < work.size(); i++)
+		{
+			work[i].rbuf = dst;
+			dst += work[i].len;
+		}
+
+		uint64_t t = monotonicNow();
+		if (spi->xfer(&work[0], work.size()) < 0)
+			errors.fetch_add(1, std::memory_order_relaxed);
+		frames.fetch_add(1, std::memory_order_relaxed);
+
+		if (drop)
+		{
+			overruns.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		timestamps[(size_t) (block % numBlocks) * framesPerBlock + frame] = t;
+		if (++frame == framesPerBlock)
+		{
+			blocks[block % numBlocks].sequence = block;
+			head.store(++block, std::memory_order_release);
+			frame = 0;
+
+			// Wake up the application without taking any lock
+			uint64_t one = 1;
+			if (write(event, &one, sizeof(one)) < 0)
+			{
+				// Counter is saturated, the application has enough to read
+			}
+		}
+	}
+
+	if (timer >= 0)
+		close(timer);
+}
+
+const SPIStream::Block *SPIStream::acquire(int timeoutMs)
+{
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	uint64_t deadline = monotonicNow() + (uint64_t) timeoutMs * 1000000ull;
+
+	while (head.load(std::memory_order_acquire) == t)
+	{
+		// No more blocks come once the stream is stopped
+		if (!running.load(std::memory_order_acquire))
+		{
+			if (head.load(std::memory_order_acquire) == t)
+				return nullptr;
+			break;
+		}
+
+		int wait = timeoutMs;
+		if (timeoutMs > 0)
+		{
+			uint64_t n = monotonicNow();
+			if (n >= deadline)
+				return nullptr;
+			wait = (deadline - n + 999999) / 1000000;
+		}
+		else if (timeoutMs == 0)
+			return nullptr;
+
+		struct pollfd pfd;
+		pfd.fd = event;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, wait) > 0)
+		{
+			uint64_t count;
+			if (read(event, &count, sizeof(count)) < 0)
+			{
+				// Someone else drained it, check the ring anyway
+			}
+		}
+		else if (timeoutMs > 0 && monotonicNow() >= deadline)
+			return nullptr;
+	}
+
+	return &blocks[t % numBlocks];
+}
+
+void SPIStream::release()
+{
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	if (t != head.load(std::memory_order_acquire))
+		tail.store(t + 1, std::memory_order_release);
+}
+
+uint32_t SPIStream::available()
+{
+	return head.load(std::memory_order_acquire)
+			- tail.load(std::memory_order_acquire);
+}
+
+SPIStream::Stats SPIStream::getStats()
+{
+	Stats s;
+	s.frames = frames.load(std::memory_order_relaxed);
+	s.overruns = overruns.load(std::memory_order_relaxed);
+	s.missed = missed.load(std::memory_order_relaxed);
+	s.errors = errors.load(std::memory_order_relaxed);
+	return s;
+}
@@ -0,0 +1,194 @@
+/*
+ * SPITransport.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "SPITransport.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#define MAX_PATH_LEN  40
+#define SPI_DEVICE_PATH_BASE "/dev/spidev"
+#define SPIDEV_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+
+#define KERNEL_BUS(bus) bus
+#ifdef _HW_PLATFORM_BEAGLEBONE
+#ifdef _KERNEL_VERSION
+// SPIDEV1 and SPIDEV2 are switched in BeagleBone kernel 4.x, but not 3.x
+#undef KERNEL_BUS
+#define KERNEL_MAJ_VER _KERNEL_VERSION[0]
+#define KERNEL_BUS(bus) KERNEL_MAJ_VER == '4' ? (bus == 2 ? 1 : (bus == 1 ? 2 : bus)) : bus
+#endif
+#endif
+
+static uint32_t parseBufsiz()
+{
+	unsigned long val = 0;
+	FILE *f = fopen(SPIDEV_BUFSIZ_PATH, "r");
+	if (f != NULL)
+	{
+		if (fscanf(f, "%lu", &val) != 1)
+			val = 0;
+		fclose(f);
+	}
+	if (val == 0 || val > UINT32_MAX)
+	{
+		iooo_debug(1, "SPI: can not read %s, assuming %d bytes\n",
+				SPIDEV_BUFSIZ_PATH, SPIDEV_DEFAULT_BUFSIZ);
+		val = SPIDEV_DEFAULT_BUFSIZ;
+	}
+	return val;
+}
+
+SPIDevTransport::SPIDevTransport()
+{
+	fd = -1;
+}
+
+SPIDevTransport::~SPIDevTransport()
+{
+	if (fd >= 0)
+		close();
+}
+
+int SPIDevTransport::open(int bus, int channel)
+{
+	char path[MAX_PATH_LEN];
+	if (snprintf(path, MAX_PATH_LEN, "%s%d.%d", SPI_DEVICE_PATH_BASE, KERNEL_BUS(bus),
+			channel) >= MAX_PATH_LEN)
+		return -EINVAL;
+
+	if (fd >= 0)
+		close();
+
+	if ((fd = ::open(path, O_RDWR, 0)) < 0)
+	{
+		int r = -errno;
+		iooo_error("open(%s) failed: %s\n", path, strerror(-r));
+		return r;
+	}
+	return 1;
+}
+
+int SPIDevTransport::close()
+{
+	int tmpfd = fd;
+	fd = -1;
+	return ::close(tmpfd) < 0 ? -errno : 0;
+}
+
+int SPIDevTransport::getSettings(SPI::Profile &settings)
+{
+	uint8_t tmp;
+	uint32_t tmp32;
+	int r;
+#ifdef SPI_IOC_RD_MODE32
+	// Older kernels only know the 8-bit mode
+	if ((r = ioctl(fd, SPI_IOC_RD_MODE32, &tmp32)) >= 0)
+		settings.mode = tmp32;
+	else
+#endif
+	if ((r = ioctl(fd, SPI_IOC_RD_MODE, &tmp)) >= 0)
+		settings.mode = tmp;
+	else
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_RD_MODE, &tmp) failed\n");
+		return r;
+	}
+
+	if ((r = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &tmp)) < 0)
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &tmp) failed\n");
+		return r;
+	}
+	settings.bpw = tmp ? tmp : 8;
+
+	if ((r = ioctl(fd, SPI_IOC_RD_LSB_FIRST, &tmp)) < 0)
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_RD_LSB_FIRST, &tmp) failed\n");
+		return r;
+	}
+	settings.lsb_first = tmp;
+
+	if ((r = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &tmp32)) < 0)
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &tmp) failed\n");
+		return r;
+	}
+	settings.speed = tmp32;
+	return 1;
+}
+
+int SPIDevTransport::setMode(uint32_t mode)
+{
+	int r;
+	if ((mode & ~0xFFu) == 0)
+	{
+		// WR_MODE also clears the flags above the lowest byte
+		uint8_t tmp = mode;
+		r = ioctl(fd, SPI_IOC_WR_MODE, &tmp);
+	}
+	else
+	{
+#ifdef SPI_IOC_WR_MODE32
+		uint32_t tmp = mode;
+		r = ioctl(fd, SPI_IOC_WR_MODE32, &tmp);
+#else
+		errno = EINVAL;
+		r = -1;
+#endif
+	}
+
+	if (r < 0)
+	{
+		r = -errno;
+		iooo_error("SPI: setting mode 0x%x failed: %s\n", mode, strerror(-r));
+	}
+	return r;
+}
+
+int SPIDevTransport::setLSBFirst(bool lsb_first)
+{
+	uint8_t tmp = lsb_first;
+	int r;
+	if ((r = ioctl(fd, SPI_IOC_WR_LSB_FIRST, &tmp)) < 0)
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_WR_LSB_FIRST, &lsb_first): %s\n",
+				strerror(-r));
+	}
+	return r;
+}
+
+int SPIDevTransport::message(struct spi_ioc_transfer *xfers, int num)
+{
+	// SPI_IOC_MESSAGE(n) with a run-time n
+	int r = ioctl(fd, _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, num * sizeof(xfers[0])),
+			xfers);
+	if (r < 0)
+	{
+		r = -errno;
+		iooo_error("ioctl(fd, SPI_IOC_MESSAGE(%d), txinfo): %s\n", num,
+				strerror(-r));
+	}
+	return r;
+}
+
+uint32_t SPIDevTransport::getMaxMessageSize()
+{
+	// The module parameter can only be set when spidev is loaded, so it is
+	// read once and shared by all channels
+	static const uint32_t bufsiz = parseBufsiz();
+	return bufsiz;
+}
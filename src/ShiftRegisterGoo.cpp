@@ -0,0 +1,114 @@
+/*
+ * ShiftRegisterGoo.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "device/ShiftRegisterGoo.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ShiftRegisterGoo::ShiftRegisterGoo(SPI *spi, int outputs, int inputs,
+		GPIOpin *latch, int latchBit, GPIOpin *load, int loadBit) :
+		VirtualGoo((outputs > 0 ? outputs : 0) + (inputs > 0 ? inputs : 0))
+{
+	this->spi = spi;
+	outs = outputs > 0 ? outputs : 0;
+	ins = inputs > 0 ? inputs : 0;
+	this->latch = latch;
+	this->latchBit = latchBit;
+	this->load = load;
+	this->loadBit = loadBit;
+
+	int outBytes = (outs + 7) / 8;
+	int inBytes = (ins + 7) / 8;
+	bytes = outBytes > inBytes ? outBytes : inBytes;
+	tx.assign(bytes, 0);
+	rx.assign(bytes, 0);
+
+	// Lines of a 74HC595 are always outputs
+	for (int i = 0; i < outs; i++)
+		setLine(directions, i, true);
+
+	if (latch != nullptr)
+		latch->clearBit(latchBit);
+	if (load != nullptr)
+		load->setBit(loadBit);
+}
+
+ShiftRegisterGoo::~ShiftRegisterGoo()
+{
+	stopPeriodic();
+}
+
+int ShiftRegisterGoo::findLine(const char *name)
+{
+	int base;
+	int count;
+	const char *num;
+	if (strncmp(name, "OUT", 3) == 0)
+	{
+		base = 0;
+		count = outs;
+		num = name + 3;
+	}
+	else if (strncmp(name, "IN", 2) == 0)
+	{
+		base = outs;
+		count = ins;
+		num = name + 2;
+	}
+	else
+		return -1;
+
+	char *end;
+	long i = strtol(num, &end, 10);
+	if (end == num || *end != 0 || i < 0 || i >= count)
+		return -1;
+	return base + i;
+}
+
+int ShiftRegisterGoo::update(bool write, bool read)
+{
+	if (bytes == 0 || (!write && !read))
+		return 0;
+
+	// The last byte sent ends up in the register next to the host. A longer
+	// input chain pads the front, and those bytes fall off the output chain.
+	memset(&tx[0], 0, bytes);
+	int outBytes = (outs + 7) / 8;
+	for (int i = 0; i < outBytes; i++)
+		tx[bytes - 1 - i] = outputs[i];
+
+	if (read && load != nullptr)
+	{
+		load->clearBit(loadBit);
+		load->setBit(loadBit);
+	}
+
+	// Outputs are always shifted in full, so the output chain holds the
+	// shadow even when it is not latched
+	int r = spi->xfer1(&tx[0], &rx[0], bytes);
+	if (r < 0)
+		return r;
+
+	if (write && latch != nullptr)
+	{
+		latch->setBit(latchBit);
+		latch->clearBit(latchBit);
+	}
+
+	if (!read)
+		return 1;
+
+	// The register next to the host comes out first
+	for (int i = 0; i < ins; i++)
+		setLine(inputs, outs + i, (rx[i >> 3] >> (i & 7)) & 1);
+	// Outputs read back what they drive
+	for (int i = 0; i < outs; i++)
+		setLine(inputs, i, getLine(outputs, i));
+	return 1;
+}
@@ -0,0 +1,169 @@
+/*
+ * VirtualGoo.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "VirtualGoo.h"
+#include "VirtualGooP.h"
+#include "debug.h"
+
+#include <errno.h>
+
+#include <chrono>
+
+VirtualGoo::VirtualGoo(int numLines) :
+		running(false)
+{
+	this->numLines = numLines > 0 ? numLines : 0;
+	int bytes = (this->numLines + 7) / 8;
+	outputs.assign(bytes, 0);
+	directions.assign(bytes, 0);
+	inputs.assign(bytes, 0);
+	refCounters.assign(this->numLines, 0);
+	lineFlags.assign(this->numLines, 0);
+	dirty = false;
+	mode = flushImmediate;
+	period = 0;
+}
+
+VirtualGoo::~VirtualGoo()
+{
+	stopPeriodic();
+}
+
+GPIOpin *VirtualGoo::claim(char *names[], int num,
+		gpioWriteSemantics semantics, gpioFlags flags)
+{
+	if (num <= 0 || num > VirtualGooP::MaxPins)
+	{
+		iooo_debug(1, "VirtualGoo::claim(): num must be 1..%i\n",
+				VirtualGooP::MaxPins);
+		return NULL;
+	}
+
+	// Writes change the shadow under the lock and reach the device in one
+	// update, so they are atomic with respect to other blocks. The update
+	// may apply the bytes of the device one after another, so the
+	// intermediate state of the two-step semantics can not be promised.
+	if (semantics != gpioWrite && semantics != gpioWriteAtomic)
+	{
+		iooo_debug(0, "VirtualGoo::claim(): write semantics %d not supported\n",
+				semantics);
+		return NULL;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	int found[VirtualGooP::MaxPins];
+	for (int i = 0; i < num; i++)
+	{
+		found[i] = findLine(names[i]);
+		if (found[i] < 0 || found[i] >= numLines)
+		{
+			iooo_debug(1, "Pin '%s' is not a line of this expander\n", names[i]);
+			return NULL;
+		}
+		if (refCounters[found[i]] > 0
+				&& ((lineFlags[found[i]] & gpioExclusive) || (flags & gpioExclusive)))
+		{
+			iooo_debug(0, "Pin '%s' already claimed and can not be shared\n",
+					names[i]);
+			return NULL;
+		}
+	}
+
+	VirtualGooP *pin = new VirtualGooP(num, this);
+	for (int i = 0; i < num; i++)
+	{
+		pin->addLine(found[i], names[i]);
+		refCounters[found[i]]++;
+		if (flags & gpioExclusive)
+			lineFlags[found[i]] |= gpioExclusive;
+	}
+	return pin;
+}
+
+void VirtualGoo::release(GPIOpin **gpio)
+{
+	if (gpio == NULL || *gpio == NULL)
+		return;
+
+	VirtualGooP *pin = (VirtualGooP *) *gpio;
+	{
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		for (int i = 0; i < pin->current; i++)
+		{
+			int line = pin->lines[i];
+			if (--refCounters[line] <= 0)
+			{
+				refCounters[line] = 0;
+				lineFlags[line] &= ~gpioExclusive;
+			}
+		}
+	}
+
+	delete pin;
+	*gpio = NULL;
+}
+
+void VirtualGoo::changed()
+{
+	dirty = true;
+	if (mode == flushImmediate)
+		flush();
+}
+
+int VirtualGoo::flush()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	int r = update(dirty, true);
+	if (r >= 0)
+		dirty = false;
+	return r;
+}
+
+int VirtualGoo::setFlushMode(FlushMode mode, uint32_t periodUs)
+{
+	if (mode == flushPeriodic && periodUs == 0)
+		return -EINVAL;
+
+	stopPeriodic();
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	this->mode = mode;
+	period = periodUs;
+	if (mode == flushPeriodic)
+	{
+		running = true;
+		worker = std::thread(&VirtualGoo::run, this);
+	}
+	else if (dirty)
+		flush();
+	return 1;
+}
+
+void VirtualGoo::stopPeriodic()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		running = false;
+	}
+	sleeper.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+void VirtualGoo::run()
+{
+	auto next = std::chrono::steady_clock::now();
+	while (running)
+	{
+		flush();
+
+		next += std::chrono::microseconds(period);
+		std::unique_lock<std::mutex> guard(sleepLock);
+		sleeper.wait_until(guard, next, [this]
+		{	return !running;});
+	}
+}
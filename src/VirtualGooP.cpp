@@ -0,0 +1,219 @@
+/*
+ * VirtualGooP.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "VirtualGooP.h"
+#include "debug.h"
+
+#include <string.h>
+
+VirtualGooP::VirtualGooP(int num, VirtualGoo *parent) :
+		GPIOpin()
+{
+	this->parent = parent;
+	this->num = num > MaxPins ? MaxPins : num;
+	current = 0;
+	for (int i = 0; i < MaxPins; i++)
+	{
+		lines[i] = -1;
+		localNames[i][0] = 0;
+	}
+}
+
+VirtualGooP::~VirtualGooP()
+{
+	active = false;
+}
+
+int VirtualGooP::addLine(int line, const char *name)
+{
+	if (current >= num)
+		return -1;
+
+	lines[current] = line;
+	strncpy(localNames[current], name, VirtualGoo::MaxLineNameLen);
+	localNames[current][VirtualGoo::MaxLineNameLen] = 0;
+	current++;
+	active = true;
+	return 0;
+}
+
+void VirtualGooP::namePin(int i, char *name)
+{
+	if (i < 0 || i >= current)
+		return;
+	strncpy(localNames[i], name, VirtualGoo::MaxLineNameLen);
+	localNames[i][VirtualGoo::MaxLineNameLen] = 0;
+}
+
+void VirtualGooP::namePins(char *names[])
+{
+	for (int i = 0; i < current; i++)
+		namePin(i, names[i]);
+}
+
+int VirtualGooP::findPinIndex(char *name)
+{
+	for (int i = 0; i < current; i++)
+		if (strncmp(localNames[i], name, VirtualGoo::MaxLineNameLen) == 0)
+			return i;
+	iooo_debug(0, "VirtualGooP::findPinIndex(): Index for pin %s not found\n",
+			name);
+	return -1;
+}
+
+void VirtualGooP::enableOutput(bool enable)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+		if (parent->canChangeDirection(lines[i]))
+			VirtualGoo::setLine(parent->directions, lines[i], enable);
+	parent->changed();
+}
+
+void VirtualGooP::enableOutput(int i, bool enable)
+{
+	if (i < 0 || i >= current)
+	{
+		iooo_debug(1, "VirtualGooP::enableOutput(): Index %i out of range\n", i);
+		return;
+	}
+	if (!parent->canChangeDirection(lines[i]))
+		return;
+
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	if (VirtualGoo::getLine(parent->directions, lines[i]) == enable)
+		return;
+	VirtualGoo::setLine(parent->directions, lines[i], enable);
+	parent->changed();
+}
+
+void VirtualGooP::enableOutput(int *outs, int num)
+{
+	if (outs == NULL || num <= 0 || num > current)
+	{
+		iooo_debug(0, "VirtualGooP::enableOutput(): fail (current=%i, num=%i)\n",
+				current, num);
+		return;
+	}
+	uint32_t oe = 0;
+	for (int i = 0; i < num; i++)
+		if (outs[i] >= 0 && outs[i] < current)
+			oe |= 1u << outs[i];
+
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+		if (parent->canChangeDirection(lines[i]))
+			VirtualGoo::setLine(parent->directions, lines[i], (oe >> i) & 1);
+	parent->changed();
+}
+
+void VirtualGooP::enableOutput(char **outNames, int num)
+{
+	if (outNames == NULL || num <= 0 || num > current)
+	{
+		iooo_debug(0, "VirtualGooP::enableOutput(): fail\n");
+		return;
+	}
+	int outs[MaxPins];
+	int n = 0;
+	for (int i = 0; i < num; i++)
+	{
+		if (outNames[i] == NULL)
+			continue;
+		int out = findPinIndex(outNames[i]);
+		if (out >= 0)
+			outs[n++] = out;
+	}
+	if (n > 0)
+		enableOutput(outs, n);
+	else
+		enableOutput(false);
+}
+
+void VirtualGooP::write(uint32_t v)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+		VirtualGoo::setLine(parent->outputs, lines[i], (v >> i) & 1);
+	parent->changed();
+}
+
+void VirtualGooP::set(uint32_t v)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+		if ((v >> i) & 1)
+			VirtualGoo::setLine(parent->outputs, lines[i], true);
+	parent->changed();
+}
+
+void VirtualGooP::setBit(int bit)
+{
+	if (bit < 0 || bit >= current)
+		return;
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	VirtualGoo::setLine(parent->outputs, lines[bit], true);
+	parent->changed();
+}
+
+void VirtualGooP::clear(uint32_t v)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+		if ((v >> i) & 1)
+			VirtualGoo::setLine(parent->outputs, lines[i], false);
+	parent->changed();
+}
+
+void VirtualGooP::clearBit(int bit)
+{
+	if (bit < 0 || bit >= current)
+		return;
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	VirtualGoo::setLine(parent->outputs, lines[bit], false);
+	parent->changed();
+}
+
+uint32_t VirtualGooP::read()
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	if (parent->getFlushMode() == VirtualGoo::flushImmediate)
+		parent->flush();
+
+	uint32_t r = 0;
+	for (int i = 0; i < current; i++)
+		if (VirtualGoo::getLine(parent->inputs, lines[i]))
+			r |= 1u << i;
+	return r;
+}
+
+void VirtualGooP::saveState(State &state)
+{
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	state.outputs = 0;
+	state.values = 0;
+	for (int i = 0; i < current; i++)
+	{
+		if (VirtualGoo::getLine(parent->directions, lines[i]))
+			state.outputs |= 1u << i;
+		if (VirtualGoo::getLine(parent->outputs, lines[i]))
+			state.values |= 1u << i;
+	}
+}
+
+void VirtualGooP::restoreState(const State &state)
+{
+	// Values and directions go out in the same update
+	std::lock_guard<std::recursive_mutex> guard(parent->lock);
+	for (int i = 0; i < current; i++)
+	{
+		VirtualGoo::setLine(parent->outputs, lines[i], (state.values >> i) & 1);
+		if (parent->canChangeDirection(lines[i]))
+			VirtualGoo::setLine(parent->directions, lines[i],
+					(state.outputs >> i) & 1);
+	}
+	parent->changed();
+}